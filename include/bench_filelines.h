@@ -0,0 +1,50 @@
+#ifndef _BENCH_FILELINES_H
+#define _BENCH_FILELINES_H
+
+#include "bench_harness.h"
+#include "find_most_freq.h"
+
+#include <stdint.h>
+
+// 每次运行前对页缓存的处理
+enum FilelinesCacheMode {
+    FILELINES_CACHE_ANY,  // 不处理
+    FILELINES_CACHE_COLD, // 先把文件逐出页缓存
+    FILELINES_CACHE_WARM, // 文件没有完整缓存时先不计时地读一遍
+};
+
+/**
+ * filelines 版本（void (*)(char*, uint32_t*, uint32_t*)）的 BenchCase
+ * 吞吐量单位为 MB/s，digest 由总行数、最频繁长度及其出现次数组成
+ */
+struct FilelinesBenchCase {
+    BenchCase base;
+    char* filepath;
+    void (*func)(char*, uint32_t*, uint32_t*);
+    FilelinesCacheMode cache;
+    // 最近一次运行的结果
+    uint32_t line_num[MAX_LEN];
+    uint32_t total_lines;
+    uint32_t most_freq_len;
+    uint32_t most_freq_count;
+    // 每次运行前文件在页缓存中的比例之和及次数
+    double resident_sum;
+    int resident_runs;
+    bool drop_failed; // 冷缓存模式下逐出页缓存失败过
+};
+
+/**
+ * @param name 版本名（需在测试期间保持有效）
+ * @param filepath 测试文件
+ * @param func 被测函数
+ * @param cache 页缓存处理方式
+ */
+void filelines_bench_case_init(FilelinesBenchCase* fc, const char* name, char* filepath,
+                               void (*func)(char*, uint32_t*, uint32_t*), FilelinesCacheMode cache);
+
+/**
+ * 运行前文件在页缓存中的平均比例（0~1）
+ */
+double filelines_bench_resident(const FilelinesBenchCase* fc);
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _BENCH_HARNESS_H
+#define _BENCH_HARNESS_H
+
+#include "perf_counters.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define BENCH_DEFAULT_WARMUPS     1
+#define BENCH_DEFAULT_MIN_RUNS    3
+#define BENCH_DEFAULT_MAX_RUNS    15
+#define BENCH_DEFAULT_TARGET_CI   0.02 // 均值 95% 置信区间半宽 / 均值 达到这个比例就停止
+#define BENCH_DEFAULT_MAX_SECONDS 20.0 // 单个版本计时运行的总时长上限（至少跑完 min_runs 次）
+
+/**
+ * 运行参数：先预热 warmups 次（不计入统计），再至少运行 min_runs 次，
+ * 之后每次运行后检查置信区间，足够窄、达到 max_runs 或超过 max_seconds 时停止
+ */
+struct BenchConfig {
+    int warmups;
+    int min_runs;
+    int max_runs;
+    double target_ci;
+    double max_seconds;
+    const char* json_path; // 不为 NULL 时写入 JSON 结果
+    const char* csv_path;  // 不为 NULL 时写入 CSV 结果
+    const char* store_path; // 不为 NULL 时追加到结果库（见 bench_store.h）
+    const char* revision;   // 写入结果库的版本，NULL 时使用 bench_build_revision()
+};
+
+void bench_config_init(BenchConfig* config);
+
+/**
+ * 解析 argv[i] 开始的一个通用选项（选项说明见 bench_usage）
+ *
+ * @return 消耗的参数个数；不是通用选项返回 0；缺少参数或参数无效时输出错误并返回 -1
+ */
+int bench_parse_option(BenchConfig* config, int argc, char** argv, int i);
+
+/**
+ * 通用选项的说明（多行，每行以两个空格开头），供各程序输出用法
+ */
+const char* bench_usage();
+
+/**
+ * 一个待测版本：把 BenchCase 作为第一个成员，回调里转换回自己的类型
+ */
+struct BenchCase {
+    const char* name;
+    // 每次运行（包括预热）之前调用，不计时，可为 NULL
+    void (*setup)(BenchCase* bc);
+    // 被测调用，需把结果校验值写入 digest
+    void (*run)(BenchCase* bc);
+    // 每次运行的工作量及吞吐量单位，例如 文件大小(MB) 与 "MB/s"、浮点运算量(GFLOP) 与 "GFLOPS"
+    double work;
+    const char* unit;
+    // 结果校验值（行数、trace 等），同一版本的每次运行应该相同
+    uint64_t digest;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    double work;
+    std::vector<double> samples; // 每次计时运行的秒数
+    int warmups;
+    double mean, median, min, max, stddev;
+    double ci_low, ci_high; // 均值的 95% 置信区间（t 分布）
+    double throughput;      // work / median
+    PerfSample perf;        // 各次计时运行的平均
+    uint64_t digest;
+    bool stable; // 每次运行的 digest 都相同
+};
+
+/**
+ * 双侧 95% t 分布临界值
+ *
+ * @param df 自由度
+ */
+double bench_t_critical(int df);
+
+/**
+ * 由 samples 计算 mean/median/min/max/stddev/置信区间和吞吐量
+ */
+void bench_compute_stats(BenchResult* result);
+
+/**
+ * 按 config 运行一个版本，每次计时运行同时记录硬件计数器，进度输出到 stdout
+ */
+void bench_run(BenchCase* bc, const BenchConfig* config, BenchResult* result);
+
+/**
+ * 依次运行已登记的所有版本
+ */
+void bench_run_all(const std::vector<BenchCase*>& cases, const BenchConfig* config,
+                   std::vector<BenchResult>* results);
+
+/**
+ * 输出结果表（中位数、最快、标准差、置信区间、吞吐量、相对 results[baseline] 的加速比）和硬件计数器
+ */
+void bench_print_results(const std::vector<BenchResult>& results, int baseline = 0);
+
+/**
+ * 写入 JSON：{"benchmark": ..., "config": {...}, "results": [{统计量, "samples": [...], "counters": {...}}]}
+ *
+ * @return 成功返回 true
+ */
+bool bench_write_json(const char* path, const char* benchmark, const BenchConfig* config,
+                      const std::vector<BenchResult>& results);
+
+/**
+ * 写入 CSV：表头一行，每个版本一行（不含每次运行的样本）
+ */
+bool bench_write_csv(const char* path, const char* benchmark, const std::vector<BenchResult>& results);
+
+/**
+ * 按 config 中设置的路径写 JSON/CSV、追加到结果库，失败时输出错误
+ *
+ * @return 全部成功（或没有设置路径）返回 true
+ */
+bool bench_emit(const BenchConfig* config, const char* benchmark, const std::vector<BenchResult>& results);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _BENCH_STORE_H
+#define _BENCH_STORE_H
+
+#include "bench_harness.h"
+
+#include <string>
+#include <vector>
+
+#define BENCH_STORE_DEFAULT "bench_results.tsv" // 未指定时使用当前目录下的这个文件
+
+/**
+ * 运行机器的标识：指纹由主机名、CPU 型号、在线 CPU 数、内存大小和内核版本哈希得到，
+ * 同一台机器换了硬件或内核后指纹会变化，不同机器的结果不会被拿来比较
+ */
+struct BenchHost {
+    std::string fingerprint; // 16 位十六进制
+    std::string cpu_model;
+    std::string hostname;
+};
+
+void bench_host_detect(BenchHost* host);
+
+/**
+ * 当前构建的版本：环境变量 BENCH_REVISION（可用来区分同一提交的不同编译器/编译选项），
+ * 否则为编译时的 git describe --always --dirty，都没有时为 "unknown"
+ */
+const char* bench_build_revision();
+
+/**
+ * 结果库中的一条记录（一个版本的一次测试）
+ * 文件每行一条，制表符分隔：
+ *   时间戳 指纹 CPU型号 版本 编译器 benchmark 版本名 吞吐量单位 工作量 各次运行秒数（逗号分隔）
+ */
+struct BenchRecord {
+    long long timestamp;
+    std::string fingerprint;
+    std::string cpu_model;
+    std::string revision;
+    std::string compiler;
+    std::string benchmark;
+    std::string variant;
+    std::string unit;
+    double work;
+    std::vector<double> samples;
+};
+
+/**
+ * 把一次测试的结果追加到结果库（只追加，不修改已有记录）
+ *
+ * @param path 结果库文件，不存在时创建
+ * @param benchmark 测试程序名
+ * @param results 各版本的结果
+ * @param revision 版本，NULL 时使用 bench_build_revision()
+ * @return 成功返回 true
+ */
+bool bench_store_append(const char* path, const char* benchmark, const std::vector<BenchResult>& results,
+                        const char* revision = NULL);
+
+/**
+ * 读取结果库，跳过格式不对的行
+ *
+ * @param skipped 输出（可为 NULL）：跳过的行数
+ * @return 文件无法打开返回 false
+ */
+bool bench_store_load(const char* path, std::vector<BenchRecord>* records, int* skipped = NULL);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _DIRECT_IO_H
+#define _DIRECT_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// O_DIRECT 要求缓冲区地址、读取长度和文件偏移都按逻辑块对齐，这里统一按4KB对齐
+#define DIRECT_IO_ALIGN 4096
+
+/**
+ * 打开文件用于顺序扫描
+ * direct 为 true 时使用 O_DIRECT 绕过页缓存；文件系统不支持时（例如 tmpfs 返回 EINVAL）退回普通读取
+ *
+ * @param filepath 文件路径
+ * @param direct 是否尝试 O_DIRECT
+ * @return 文件描述符，失败返回 -1
+ */
+int open_for_scan(const char* filepath, bool direct);
+
+/**
+ * 分配 DIRECT_IO_ALIGN 对齐的读缓冲区，长度向上取整到对齐粒度，用 free() 释放
+ */
+char* alloc_io_buffer(size_t size);
+
+/**
+ * 读取一块数据，行为与 read()/pread() 相同（offset < 0 时使用 read）
+ * O_DIRECT 下如果请求不满足对齐要求（例如文件末尾不足4KB的部分，或前一次短读后偏移不再对齐），
+ * 这一次请求另外以普通方式打开同一文件读取，不修改描述符的标志（描述符可能被多个线程共享），
+ * 之后对齐的请求仍然绕过页缓存
+ */
+ssize_t read_for_scan(int handle, char* buffer, size_t size, off_t offset = -1);
+
+#endif
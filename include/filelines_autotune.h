@@ -0,0 +1,47 @@
+#ifndef _FILELINES_AUTOTUNE_H
+#define _FILELINES_AUTOTUNE_H
+
+#include <stdint.h>
+
+#define AUTOTUNE_PROBE_BYTES (256ULL << 20) // 默认只用文件开头 256MB 探测
+#define AUTOTUNE_CACHE_ENV   "FILELINES_TUNE_CACHE"
+
+/**
+ * 一个设备/文件系统上生产者-消费者版本的最佳读取参数
+ * tmpfs、本地 NVMe 和网络存储想要的块大小和队列深度差别很大，按设备分别保存
+ */
+struct TuneConfig {
+    uint64_t dev;     // 文件所在设备号（st_dev）
+    uint64_t fs_type; // 文件系统类型（statfs 的 f_type），设备号被复用时避免误用其他文件系统的结果
+    uint32_t block_size;
+    uint32_t queue_size;
+    double throughput; // 探测时的吞吐量（MB/s），仅供参考
+};
+
+/**
+ * 在 filepath 开头的 probe_bytes 字节上尝试几种块大小和队列大小，选出吞吐量最高的组合并写入缓存文件
+ * 先在默认队列大小（4）下比较 64KB/256KB/1MB/4MB 块，再在最佳块大小下比较 2/4/8/16 个槽位；
+ * 每次探测前用 POSIX_FADV_DONTNEED 丢掉这段文件的页缓存，测的是设备本身的读取速度（tmpfs 上丢不掉，测的就是内存）
+ *
+ * @param filepath 用于探测的文件（要分析的文件本身，或同一设备上的校准文件）
+ * @param config 输出：最佳参数
+ * @param probe_bytes 探测的字节数，0 时使用 AUTOTUNE_PROBE_BYTES
+ * @param verbose 为 true 时在 stderr 输出每次探测的结果
+ * @return 成功返回0；文件无法打开或为空时返回 -1（缓存写入失败不影响返回值）
+ */
+int filelines_autotune(char* filepath, TuneConfig* config, uint64_t probe_bytes = 0, bool verbose = false);
+
+/**
+ * 查找 filepath 所在设备/文件系统的调优结果
+ *
+ * @return 找到返回0，没有调优过（或缓存文件不存在）返回 -1
+ */
+int autotune_lookup(const char* filepath, TuneConfig* config);
+
+/**
+ * 缓存文件路径：环境变量 FILELINES_TUNE_CACHE，未设置时为 $HOME/.filelines_tune
+ * 文本格式，每行一个设备："dev fs_type block_size queue_size throughput"
+ */
+const char* autotune_cache_path();
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _FILELINES_BATCH_H
+#define _FILELINES_BATCH_H
+
+#include "line_histogram.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * 批量分析中单个文件的结果
+ */
+struct BatchFileResult {
+    std::string filepath;
+    uint64_t file_size;
+    bool ok; // 文件无法打开或读取时为 false，此时 hist 为空
+    LineHistogram hist;
+};
+
+/**
+ * 收集待分析的文件：普通文件直接加入，目录递归加入其中所有普通文件（按文件名排序）
+ *
+ * @param path 文件或目录路径
+ * @param files 输入输出：追加收集到的文件路径
+ * @return 成功返回0，path 无法访问时返回 -1
+ */
+int batch_collect_path(const char* path, std::vector<std::string>* files);
+
+/**
+ * 从列表文件读取待分析的文件路径，每行一个，忽略空行；list_file 为 "-" 时读取标准输入
+ * 列表中的目录同样会被递归展开
+ *
+ * @return 成功返回0，列表文件无法打开时返回 -1
+ */
+int batch_read_list(const char* list_file, std::vector<std::string>* files);
+
+/**
+ * 批量文件行分析：所有文件共用一个固定大小的工作线程池
+ * 大文件按固定大小切成多个区间任务，小文件整个作为一个任务，任务按文件大小从大到小
+ * 分配到各线程的队列，线程做完自己的任务后从其他线程的队列尾部窃取，
+ * 这样大小文件混在一起时各线程的负载也能保持均衡
+ * 每个文件的结果与 filelines_mt_split_wide 完全一致
+ *
+ * @param files 文件路径列表
+ * @param results 输出：与 files 一一对应的单文件结果
+ * @param aggregate 输入输出：所有文件合并后的直方图（需先 line_histogram_init）
+ * @param num_threads 工作线程数，<= 0 时使用在线CPU核数
+ */
+void filelines_batch(const std::vector<std::string>& files, std::vector<BatchFileResult>* results,
+                     LineHistogram* aggregate, int num_threads = 0);
+
+#endif
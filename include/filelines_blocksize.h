@@ -12,9 +12,12 @@
  * @param total_line_num 输出：总行数
  * @param line_num 输出：各长度行的数量统计数组
  * @param block_size 块大小（字节）
+ * @param direct_io 为 true 时使用 O_DIRECT 绕过页缓存（块大小需为4KB的整数倍，否则仍走页缓存）
+ * @return 实际以 O_DIRECT 打开返回 true；未请求、块大小不对齐或文件系统不支持（例如 tmpfs）时返回 false
 
  * 这里我直接指定256kb为默认块大小
  */
-void filelines_with_blocksize(char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size = 262144);
+bool filelines_with_blocksize(char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size = 262144,
+                              bool direct_io = false);
 
 #endif
@@ -0,0 +1,50 @@
+#ifndef _FILELINES_CHECKPOINT_H
+#define _FILELINES_CHECKPOINT_H
+
+#include "line_histogram.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECKPOINT_MAGIC     "FLCKPT\0\0"
+#define CHECKPOINT_VERSION   1
+#define CHECKPOINT_HASH_SIZE 4096 // 校验已扫描部分最后 4KB，发现文件被原地改写或截断后重新写入
+
+/**
+ * 增量分析的检查点（按本机字节序直接写入文件）
+ * 记录已扫描到的位置、跨位置的未结束行长度、到该位置为止的直方图和文件指纹
+ */
+struct LineCheckpoint {
+    char magic[8];
+    uint32_t version;
+    uint32_t struct_size; // sizeof(LineCheckpoint)，MAX_LEN 等编译期参数变化时旧检查点自动失效
+
+    // 文件指纹：设备号 + inode 识别日志轮转，mtime 用于没有新数据时跳过校验读取
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t tail_hash; // [offset - CHECKPOINT_HASH_SIZE, offset) 的 FNV-1a 哈希
+
+    uint64_t offset;  // 已扫描的字节数
+    uint64_t cur_len; // offset 处尚未结束的行已扫描的长度
+    LineHistogram hist;
+};
+
+/**
+ * 增量文件行分析：读取检查点后只扫描上次之后追加的部分，再写回新的检查点
+ * 检查点不存在、格式不符、文件被替换（inode 变化）、截断或已扫描部分被改写时，从头完整扫描
+ * 新增部分较大时按 num_threads 分段并行扫描，结果与完整扫描整个文件一致
+ * 检查点先写入临时文件再 rename，进程中途退出不会留下损坏的检查点
+ *
+ * @param filepath 文件路径
+ * @param checkpoint_path 检查点文件路径
+ * @param hist 输出：整个文件的行长度直方图（函数内初始化）
+ * @param num_threads 扫描线程数，<= 0 时使用在线CPU核数
+ * @param scanned_bytes 输出（可为 NULL）：本次实际扫描的字节数
+ * @return 从检查点续扫返回1，完整扫描返回0，文件无法打开或读取失败返回-1（此时不更新检查点，hist 无效）
+ */
+int filelines_incremental(const char* filepath, const char* checkpoint_path, LineHistogram* hist,
+                          int num_threads = 0, uint64_t* scanned_bytes = NULL);
+
+#endif
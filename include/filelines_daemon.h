@@ -0,0 +1,77 @@
+#ifndef _FILELINES_DAEMON_H
+#define _FILELINES_DAEMON_H
+
+#include "line_histogram.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DAEMON_SOCKET_ENV     "FILELINES_SOCKET"
+#define DAEMON_DEFAULT_SOCKET "/tmp/filelines.sock"
+#define DAEMON_MAGIC          0x464c4431 // "FLD1"
+#define DAEMON_MAX_PATH       4096
+
+// 请求类型
+#define DAEMON_OP_QUERY    1 // 返回文件的行长度直方图
+#define DAEMON_OP_SHUTDOWN 2 // 让守护进程退出（测试和脚本使用）
+
+// 请求标志
+#define DAEMON_FLAG_REFRESH 1 // 忽略缓存，重新扫描并更新缓存
+
+/**
+ * 请求：固定头部之后紧跟 path_len 字节的绝对路径（不含结尾的 '\0'）
+ * 守护进程和客户端在同一台机器上，按本机字节序传输
+ */
+struct DaemonRequest {
+    uint32_t magic;
+    uint32_t op;
+    uint32_t flags;
+    uint32_t path_len;
+};
+
+/**
+ * 响应：status 为0时紧跟一个 LineHistogram
+ */
+struct DaemonResponse {
+    uint32_t magic;
+    int32_t status;  // 0 成功，否则为负的 errno
+    uint32_t cached; // 结果是否直接来自缓存
+    uint32_t reserved;
+    // 扫描时的文件指纹，也是缓存的键
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+};
+
+/**
+ * 守护进程的套接字路径：环境变量 FILELINES_SOCKET，未设置时为 DAEMON_DEFAULT_SOCKET
+ */
+const char* daemon_socket_path();
+
+/**
+ * 向守护进程查询一个文件的行长度直方图（相对路径按调用方的当前目录解析）
+ *
+ * @param socket_path 套接字路径，NULL 时使用 daemon_socket_path()
+ * @param filepath 文件路径
+ * @param flags DAEMON_FLAG_* 的组合
+ * @param hist 输出：行长度直方图
+ * @param response 输出：响应头（可为 NULL），包含是否命中缓存和文件指纹
+ * @return 成功返回0；连接失败或守护进程返回错误时返回 -1，并设置 errno
+ */
+int daemon_query(const char* socket_path, const char* filepath, uint32_t flags, LineHistogram* hist,
+                 DaemonResponse* response = NULL);
+
+/**
+ * 请求守护进程退出
+ *
+ * @return 成功返回0，连接失败返回 -1
+ */
+int daemon_shutdown(const char* socket_path);
+
+// 阻塞读写完整的 size 字节（守护进程和客户端共用），成功返回 true
+bool daemon_send_all(int fd, const void* data, size_t size);
+bool daemon_recv_all(int fd, void* data, size_t size);
+
+#endif
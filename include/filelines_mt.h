@@ -1,6 +1,9 @@
 #ifndef _FILELINES_MT_H
 #define _FILELINES_MT_H
 
+#include "line_histogram.h"
+
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -16,4 +19,66 @@
  */
 void filelines_mt(char* filepath, uint32_t* total_line_num, uint32_t* line_num);
 
+/**
+ * filelines_mt 的 O_DIRECT 版本：生产者线程绕过页缓存读取，扫描大文件时不会挤掉其他服务的热数据
+ * 文件系统不支持 O_DIRECT 时自动退回普通读取
+ */
+void filelines_mt_direct(char* filepath, uint32_t* total_line_num, uint32_t* line_num);
+
+/**
+ * 块大小和队列大小可调的 filelines_mt（见 filelines_autotune.h，按设备缓存的调优结果通过它生效）
+ *
+ * @param filepath 文件路径
+ * @param total_line_num 输出：总行数
+ * @param line_num 输出：各长度行的数量统计数组
+ * @param block_size 每次读取的块大小（按4KB向上取整），0 时使用默认的256KB
+ * @param queue_size 缓冲队列槽位数（最多64），<= 0 时使用默认的4
+ * @param max_bytes 只统计文件开头的这么多字节，0 表示整个文件（调优探测时使用）
+ * @param direct_io 为 true 时生产者使用 O_DIRECT 读取
+ */
+void filelines_mt_config(char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size,
+                         int queue_size, uint64_t max_bytes = 0, bool direct_io = false);
+
+/**
+ * 多线程分段版本的文件行分析函数
+ * 把文件按字节切成 num_threads 段，每个线程用 pread 独立扫描自己的一段，
+ * 最后按顺序合并各段的统计，并把跨段的首尾半行拼接起来
+ * 结果与 filelines_baseline 完全一致
+ *
+ * @param filepath 文件路径
+ * @param total_line_num 输出：总行数
+ * @param line_num 输出：各长度行的数量统计数组
+ * @param num_threads 线程数，<= 0 时使用在线CPU核数
+ * @param use_mmap 为 true 时映射整个文件，各线程直接扫描映射内存（零拷贝）
+ * @param direct_io 为 true 时使用 O_DIRECT 绕过页缓存读取（此时忽略 use_mmap）
+ * @return 成功返回 true；文件无法打开、内存分配失败、读取出错或文件在扫描期间被截断时返回 false，输出不变
+ */
+bool filelines_mt_split(char* filepath, uint32_t* total_line_num, uint32_t* line_num, int num_threads = 0,
+                        bool use_mmap = false, bool direct_io = false);
+
+/**
+ * filelines_mt_split 的64位计数版本：统计结果累加到两级直方图中，
+ * 总行数和各长度计数都不会在 40 亿处回绕，超长行按长度量级单独分桶
+ *
+ * @param filepath 文件路径
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ * 其余参数和返回值同 filelines_mt_split（失败时 hist 不变）
+ */
+bool filelines_mt_split_wide(char* filepath, LineHistogram* hist, int num_threads = 0, bool use_mmap = false,
+                             bool direct_io = false);
+
+/**
+ * io_uring 版本的文件行分析函数
+ * 同时保持 queue_depth 个异步读请求在途（使用注册的固定缓冲区），
+ * 读完成后按文件顺序交给SIMD统计，统计过程中设备上始终有请求在处理，
+ * 不需要单独的生产者线程。内核不支持 io_uring、提交失败或读取出错时自动退回 filelines_mt
+ * （出错前已统计的部分会丢弃，不会留下不完整的结果）
+ *
+ * @param filepath 文件路径
+ * @param total_line_num 输出：总行数
+ * @param line_num 输出：各长度行的数量统计数组
+ * @param queue_depth 在途读请求数（每个请求一个256KB块），<= 0 时使用默认值32
+ */
+void filelines_mt_uring(char* filepath, uint32_t* total_line_num, uint32_t* line_num, int queue_depth = 0);
+
 #endif
@@ -0,0 +1,65 @@
+#ifndef _FILELINES_PIPELINE_H
+#define _FILELINES_PIPELINE_H
+
+#include "filelines_batch.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define PIPELINE_BLOCK_SIZE      (256 << 10) // 256KB
+#define PIPELINE_BLOCKS_PER_FILE 4           // 每个文件在读取和各阶段之间循环使用的缓冲块数
+#define PIPELINE_FILES_IN_FLIGHT 8           // 每个事件循环线程同时处理的文件数
+
+/**
+ * 流水线阶段：按文件顺序接收数据块
+ * 同一个文件的回调总是在同一个线程上依次发生；不同文件可能在不同线程上同时回调，
+ * 实现只需把每个文件的状态放在 begin_file 返回的对象里，结果按 file_index 写到各自的位置
+ * 自定义阶段把 PipelineStage 作为第一个成员，回调里直接转换回自己的类型
+ */
+struct PipelineStage {
+    // 文件开始，返回该文件的私有状态，传给之后的 process/end_file
+    void* (*begin_file)(PipelineStage* stage, size_t file_index, uint64_t file_size);
+    void (*process)(PipelineStage* stage, void* state, const char* data, size_t size);
+    // 文件结束（打开或读取失败时 ok 为 false，此前处理的数据不完整），需在这里释放 state
+    void (*end_file)(PipelineStage* stage, void* state, size_t file_index, bool ok);
+};
+
+/**
+ * 行长度统计阶段：结果与 filelines_batch 一致，写入 results[file_index]（需预先按文件数分配）
+ */
+struct HistogramStage {
+    PipelineStage base;
+    std::vector<BatchFileResult>* results;
+};
+
+void histogram_stage_init(HistogramStage* stage, std::vector<BatchFileResult>* results);
+
+/**
+ * CRC32C 校验阶段（支持 SSE4.2 时使用 crc32 指令），结果写入 crcs[file_index]（需预先按文件数分配）
+ */
+struct ChecksumStage {
+    PipelineStage base;
+    std::vector<uint32_t>* crcs;
+};
+
+void checksum_stage_init(ChecksumStage* stage, std::vector<uint32_t>* crcs);
+
+/**
+ * 协程流水线批量分析：每个线程运行一个事件循环，同时处理 files_in_flight 个文件
+ * 每个文件是一组协程：读取协程 co_await 异步读（io_uring，不可用时退回同步 pread），
+ * 读完的块依次 co_await 交给各阶段协程，最后一个阶段把块还给读取协程；
+ * 一个文件等待 I/O 时事件循环去处理其他文件已经读到的块，少量线程就能保持很多读请求在途
+ * 新增阶段只需实现 PipelineStage 的回调，不需要任何线程代码
+ *
+ * @param files 文件路径列表
+ * @param stages 阶段列表（按顺序处理每一块，至少一个）
+ * @param num_threads 事件循环线程数，<= 0 时使用在线CPU核数
+ * @param files_in_flight 每个线程同时处理的文件数，<= 0 时使用 PIPELINE_FILES_IN_FLIGHT
+ * @return 使用了 io_uring 返回 true，退回同步读取返回 false
+ */
+bool filelines_pipeline(const std::vector<std::string>& files, const std::vector<PipelineStage*>& stages,
+                        int num_threads = 0, int files_in_flight = 0);
+
+#endif
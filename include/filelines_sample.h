@@ -0,0 +1,44 @@
+#ifndef _FILELINES_SAMPLE_H
+#define _FILELINES_SAMPLE_H
+
+#include "find_most_freq.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_CHUNKS     256         // 默认抽样块数
+#define SAMPLE_CHUNK_SIZE (256 << 10) // 每个抽样块 256KB，默认共读取 64MB
+
+/**
+ * 抽样估计的精度信息（95% 置信区间的半宽，即结果 ± ci）
+ */
+struct SampleEstimate {
+    uint64_t file_size;
+    uint64_t sampled_bytes; // 实际读取的字节数（包括对齐到行首、读完最后一行多读的部分）
+    int num_chunks;         // 0 表示文件小于抽样总量，已经完整扫描，结果是精确值
+    double total_line_num_ci;
+    double line_num_ci[MAX_LEN];
+};
+
+/**
+ * 抽样版本的文件行分析：不读整个文件，而是把文件等分成 num_chunks 层，每层随机取一个 chunk_size 字节的块，
+ * 用 pread 读取，统计起点落在块内的完整行（块开头先对齐到下一个行首，块末尾的行读到它的换行符为止），
+ * 再按 文件大小 / 抽样字节数 外推总行数和各长度的行数
+ * 统计使用 process_block_simd_opt，输出与 filelines_simd 的格式相同，可以直接交给 find_most_freq_line
+ *
+ * 置信区间把每层的外推结果视为独立样本，用样本标准差 / sqrt(num_chunks) 估计标准误差；
+ * 分层抽样的实际误差通常更小，区间偏保守
+ *
+ * @param filepath 文件路径
+ * @param total_line_num 输出：估计的总行数（四舍五入）
+ * @param line_num 输出：估计的各长度行数（四舍五入）
+ * @param estimate 输出：精度信息（可为 NULL）
+ * @param num_chunks 抽样块数，<= 0 时使用 SAMPLE_CHUNKS（至少2个，用于估计方差）
+ * @param chunk_size 每块字节数，0 时使用 SAMPLE_CHUNK_SIZE
+ * @param seed 随机种子，相同的种子抽到相同的块
+ * @return 成功返回0，文件无法打开返回 -1
+ */
+int filelines_sample(char* filepath, uint32_t* total_line_num, uint32_t* line_num, SampleEstimate* estimate = NULL,
+                     int num_chunks = 0, size_t chunk_size = 0, uint64_t seed = 0);
+
+#endif
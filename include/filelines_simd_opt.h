@@ -1,10 +1,13 @@
 #ifndef _FILELINES_SIMD_H
 #define _FILELINES_SIMD_H
 
+#include "line_histogram.h"
+#include "simd_kernel.h"
+
 #include <stdint.h>
 
 /**
- * SIMD优化版本的文件行分析函数（使用AVX2指令集）
+ * SIMD优化版本的文件行分析函数（运行时选择 SSE2/AVX2/AVX-512BW 内核，见 simd_kernel.h）
  * 使用256KB块大小（与basic_benchmark一致）
  *
  * @param filepath 文件路径
@@ -13,4 +16,50 @@
  */
 void filelines_simd(char* filepath, uint32_t* total_line_num, uint32_t* line_num);
 
+/**
+ * 64位计数版本的SIMD文件行分析函数，结果累加到两级直方图中（行数不回绕，长行不封顶）
+ *
+ * @param filepath 文件路径
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ */
+void filelines_simd_wide(char* filepath, LineHistogram* hist);
+
+/**
+ * 自定义行分隔符版本（例如 NUL 或 0x1e 分隔的记录文件、CRLF 文本），结果累加到两级直方图中
+ *
+ * @param filepath 文件路径
+ * @param set 分隔符集合（见 delimiter_set_init）
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ */
+void filelines_simd_delim(char* filepath, const DelimiterSet* set, LineHistogram* hist);
+
+/**
+ * wc 风格的融合版本：一遍扫描同时统计行长度直方图、单词数、UTF-8 字符数和字节数，
+ * 代替 filelines 之后再跑一次 wc -w -m
+ *
+ * @param filepath 文件路径
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ * @param counts 输入输出：单词、字符、字节计数（需先 wc_counts_init，决定行长度按字节还是字符统计）
+ */
+void filelines_simd_wc(char* filepath, LineHistogram* hist, WcCounts* counts);
+
+/**
+ * CSV/TSV 列统计：一遍扫描得到每条记录的字段数分布和各列字段宽度分布（识别双引号包围的字段）
+ *
+ * @param filepath 文件路径
+ * @param stats 输入输出：列统计（需先 csv_stats_init 指定分隔符），返回前已调用 csv_stats_finish
+ */
+void filelines_simd_csv(char* filepath, CsvStats* stats);
+
+/**
+ * mmap 版本的SIMD文件行分析函数
+ * 把整个文件映射到内存，SIMD直接扫描映射的页缓存，没有 read() 的额外拷贝
+ * 映射区域设置 MADV_SEQUENTIAL，并在支持时设置 MADV_HUGEPAGE
+ *
+ * @param filepath 文件路径
+ * @param total_line_num 输出：总行数
+ * @param line_num 输出：各长度行的数量统计数组
+ */
+void filelines_simd_mmap(char* filepath, uint32_t* total_line_num, uint32_t* line_num);
+
 #endif
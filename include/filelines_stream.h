@@ -0,0 +1,47 @@
+#ifndef _FILELINES_STREAM_H
+#define _FILELINES_STREAM_H
+
+#include "line_histogram.h"
+#include "simd_kernel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * 流式文件行分析函数：从已打开的描述符（管道、套接字、标准输入）读到 EOF
+ * 输入是管道时先把管道容量调大（F_SETPIPE_SZ），让写端一次写入更多数据，减少双方的唤醒次数；
+ * 每次读到多少就扫描多少，跨读取边界的行由 cur_len 延续，结果与对同一内容调用 filelines_baseline 一致
+ *
+ * @param fd 输入描述符（不会被关闭）
+ * @param total_line_num 输出：总行数
+ * @param line_num 输出：各长度行的数量统计数组
+ */
+void filelines_stream(int fd, uint32_t* total_line_num, uint32_t* line_num);
+
+/**
+ * filelines_stream 的64位计数版本，结果累加到两级直方图中
+ *
+ * @param fd 输入描述符（不会被关闭）
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ * @param set 行分隔符集合，为 NULL 时按 '\n' 分行
+ */
+void filelines_stream_wide(int fd, LineHistogram* hist, const DelimiterSet* set = NULL);
+
+/**
+ * filelines_simd_wc 的流式版本：一遍读取同时统计行长度直方图和单词、字符、字节数
+ *
+ * @param fd 输入描述符（不会被关闭）
+ * @param hist 输入输出：行长度直方图（需先 line_histogram_init）
+ * @param counts 输入输出：wc 计数（需先 wc_counts_init）
+ */
+void filelines_stream_wc(int fd, LineHistogram* hist, WcCounts* counts);
+
+/**
+ * filelines_simd_csv 的流式版本：引号、字段等跨读取边界的状态保存在 stats 中
+ *
+ * @param fd 输入描述符（不会被关闭）
+ * @param stats 输入输出：列统计（需先 csv_stats_init 指定分隔符），返回前已调用 csv_stats_finish
+ */
+void filelines_stream_csv(int fd, CsvStats* stats);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _HUGE_PAGES_H
+#define _HUGE_PAGES_H
+
+#include <memory>
+#include <new>
+#include <stddef.h>
+
+#define HUGE_PAGE_SIZE (2 << 20) // 2MB
+
+enum HugePageKind {
+    HUGE_PAGE_NONE,    // 普通 4KB 页
+    HUGE_PAGE_HUGETLB, // 预留的 hugetlbfs 大页（MAP_HUGETLB）
+    HUGE_PAGE_THP,     // 透明大页（MADV_HUGEPAGE，是否真正合并成大页由内核决定）
+};
+
+/**
+ * 分配大页内存：长度按 HUGE_PAGE_SIZE 取整，先尝试 MAP_HUGETLB（需要系统预留大页），
+ * 失败时退回按 2MB 对齐的匿名映射并 madvise(MADV_HUGEPAGE)，透明大页关闭时就是普通页
+ * 返回的内存已清零、按 2MB 对齐（同时满足 SIMD 和 O_DIRECT 的对齐要求），用 huge_free 释放
+ *
+ * @param size 字节数
+ * @param kind 输出（可为 NULL）：实际使用的页类型
+ * @return 内存地址，失败返回 NULL
+ */
+void* huge_alloc(size_t size, HugePageKind* kind = NULL);
+
+/**
+ * 释放 huge_alloc 分配的内存，size 与分配时相同
+ */
+void huge_free(void* ptr, size_t size);
+
+/**
+ * 进程级开关：打开后各 filelines 版本的读缓冲区和 run_matrix_multiply_test 的矩阵改用 huge_alloc（默认关闭）
+ * 需在分配前设置
+ */
+void huge_pages_set_enabled(bool enabled);
+bool huge_pages_enabled();
+
+const char* huge_page_kind_name(HugePageKind kind);
+
+/**
+ * 供 std::vector 使用的分配器：huge 为 true 时用 huge_alloc，否则与 std::allocator 相同
+ * 是否使用大页记录在分配器里，释放时不受之后全局开关变化的影响
+ */
+template <typename T> struct HugePageAllocator {
+    typedef T value_type;
+
+    bool huge;
+
+    HugePageAllocator(bool huge = false) : huge(huge) {}
+    template <typename U> HugePageAllocator(const HugePageAllocator<U>& other) : huge(other.huge) {}
+
+    T* allocate(size_t n) {
+        if (!huge)
+            return std::allocator<T>().allocate(n);
+        void* ptr = huge_alloc(n * sizeof(T));
+        if (!ptr)
+            throw std::bad_alloc();
+        return (T*)ptr;
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        if (huge)
+            huge_free(ptr, n * sizeof(T));
+        else
+            std::allocator<T>().deallocate(ptr, n);
+    }
+};
+
+template <typename T, typename U> bool operator==(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) {
+    return a.huge == b.huge;
+}
+
+template <typename T, typename U> bool operator!=(const HugePageAllocator<T>& a, const HugePageAllocator<U>& b) {
+    return a.huge != b.huge;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _LINE_HISTOGRAM_H
+#define _LINE_HISTOGRAM_H
+
+#include "find_most_freq.h"
+
+#include <stdint.h>
+
+#define LONG_LINE_BUCKETS 64 // 长行按 floor(log2(长度)) 分桶，64 个桶覆盖全部 uint64_t 长度
+
+/**
+ * 64位计数的两级行长度直方图，用于超过 40 亿行或需要区分超长行的场景
+ *
+ * 第一级：长度 < MAX_LEN 的行逐长度计数（8KB，热路径上常驻 L1）
+ * 第二级：长度 >= MAX_LEN 的行按 floor(log2(长度)) 分桶，同时记录桶内总字节数
+ * 注意与 uint32_t line_num[MAX_LEN] 的区别：dense[MAX_LEN - 1] 只统计长度恰好为 MAX_LEN - 1 的行
+ */
+struct LineHistogram {
+    uint64_t total_line_num;
+    uint64_t dense[MAX_LEN];
+    uint64_t long_lines[LONG_LINE_BUCKETS];       // long_lines[k]: 长度在 [2^k, 2^(k+1)) 的行数
+    uint64_t long_line_bytes[LONG_LINE_BUCKETS];  // 对应桶内所有行的长度之和
+    uint64_t max_line_len;
+};
+
+void line_histogram_init(LineHistogram* hist);
+
+// 记录一条长度 >= MAX_LEN 的行（不更新总行数，SIMD内核按位图批量累加总行数）
+static inline void line_histogram_add_long(LineHistogram* hist, uint64_t line_length) {
+    int bucket = 63 - __builtin_clzll(line_length);
+    hist->long_lines[bucket]++;
+    hist->long_line_bytes[bucket] += line_length;
+    if (line_length > hist->max_line_len)
+        hist->max_line_len = line_length;
+}
+
+// 记录一行
+static inline void line_histogram_add(LineHistogram* hist, uint64_t line_length) {
+    hist->total_line_num++;
+    if (line_length < MAX_LEN)
+        hist->dense[line_length]++;
+    else
+        line_histogram_add_long(hist, line_length);
+}
+
+// dst += src
+void line_histogram_merge(LineHistogram* dst, const LineHistogram* src);
+
+/**
+ * 折算成旧接口的 32 位统计（结果累加到输出上）：长行全部计入 line_num[MAX_LEN - 1]，计数按 2^32 取模，
+ * 与直接用 uint32_t 累加的结果完全一致
+ */
+void line_histogram_to_legacy(const LineHistogram* hist, uint32_t* total_line_num, uint32_t* line_num);
+
+/**
+ * 最频繁的行长度（只在第一级精确长度中查找）
+ */
+void find_most_freq_line64(const LineHistogram* hist, uint64_t* most_freq_len, uint64_t* most_freq_len_linenum);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _LINE_INDEX_H
+#define _LINE_INDEX_H
+
+#include "line_histogram.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LINE_INDEX_MAGIC   "FLIDX\0\0\0"
+#define LINE_INDEX_VERSION 1
+#define LINE_INDEX_STRIDE  4096 // 默认每 4096 行采样一次，定位任意一行最多再扫描 4095 行
+#define LINE_INDEX_GROUP   64   // 每 64 个采样点存一个64位绝对偏移，组内存32位相对偏移
+
+/**
+ * 行偏移索引文件头（按本机字节序存储，整个文件可以直接 mmap 使用）
+ *
+ * 文件布局：
+ *   LineIndexHeader
+ *   uint64_t bases[ceil(num_samples / LINE_INDEX_GROUP)]  每组第一个采样点的绝对偏移
+ *   uint32_t deltas[num_samples]                            采样点相对所在组起点的偏移
+ * 第 k 个采样点 = 第 k * stride 行的起始偏移 = bases[k / GROUP] + deltas[k]，O(1) 取得
+ * 行很长以至于一组跨度超过 4GB 时 wide_offsets 为1，此时不存 bases，deltas 换成 uint64_t 绝对偏移
+ */
+struct LineIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t stride;
+
+    // 源文件指纹，文件变化后索引失效
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t file_size;
+
+    uint64_t total_line_num; // 换行符个数
+    uint64_t num_samples;
+    uint32_t wide_offsets;
+    uint32_t reserved;
+};
+
+/**
+ * 打开后映射到内存的索引
+ */
+struct LineIndex {
+    void* map;
+    size_t map_size;
+    const LineIndexHeader* header;
+    const uint64_t* bases;
+    const uint32_t* deltas;
+    const uint64_t* offsets; // wide_offsets 时使用
+};
+
+/**
+ * 扫描文件建立行偏移索引并写入 index_path，统计和采样在同一遍扫描中完成
+ *
+ * @param filepath 文件路径
+ * @param index_path 索引文件路径（先写临时文件再 rename）
+ * @param hist 输入输出（可为 NULL）：扫描得到的行长度直方图累加到这里
+ * @param stride 采样间隔（行数），0 时使用 LINE_INDEX_STRIDE
+ * @return 成功返回0，失败返回 -1
+ */
+int line_index_build(const char* filepath, const char* index_path, LineHistogram* hist = NULL,
+                     uint32_t stride = 0);
+
+/**
+ * 映射索引文件并检查它是否与源文件匹配（inode、大小、修改时间）
+ *
+ * @param index 输出：打开的索引
+ * @param index_path 索引文件路径
+ * @param file_handle 源文件描述符，用于校验指纹
+ * @return 成功返回0；索引不存在、损坏或已过期返回 -1
+ */
+int line_index_open(LineIndex* index, const char* index_path, int file_handle);
+
+void line_index_close(LineIndex* index);
+
+/**
+ * 第 k 个采样点，即第 k * stride 行（从0开始）的起始偏移
+ */
+static inline uint64_t line_index_sample(const LineIndex* index, uint64_t k) {
+    if (index->header->wide_offsets)
+        return index->offsets[k];
+    return index->bases[k / LINE_INDEX_GROUP] + index->deltas[k];
+}
+
+/**
+ * 定位第 line_no 行（从0开始）的起始偏移：取最近的采样点，再用SIMD内核向后数剩余的换行符
+ *
+ * @param index 已打开的索引
+ * @param file_handle 源文件描述符
+ * @param line_no 行号；等于 total_line_num 时表示文件末尾没有换行符的最后一行
+ * @return 行首偏移，行不存在时返回 -1
+ */
+off_t line_index_seek(const LineIndex* index, int file_handle, uint64_t line_no);
+
+#endif
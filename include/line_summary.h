@@ -0,0 +1,57 @@
+#ifndef _LINE_SUMMARY_H
+#define _LINE_SUMMARY_H
+
+#include "line_histogram.h"
+
+#include <stdint.h>
+
+#define SUMMARY_MAX_TOP_K       16
+#define SUMMARY_MAX_PERCENTILES 16
+
+/**
+ * 行长度分布的汇总统计
+ * 长度 < MAX_LEN 的部分是精确值；落在长行桶（[2^k, 2^(k+1))）里的部分只能近似：
+ * 百分位取桶内平均长度，平方和按桶内平均长度估算，最小值取桶下界，最大值使用 max_line_len（精确）
+ */
+struct LineSummary {
+    uint64_t total_line_num;
+    uint64_t min_len;
+    uint64_t max_len;
+    double mean;
+    double stddev;
+
+    int top_k; // 实际找到的个数（不同长度的个数少于请求的 K 时会更少）
+    uint64_t top_len[SUMMARY_MAX_TOP_K];
+    uint64_t top_count[SUMMARY_MAX_TOP_K];
+
+    int num_percentiles;
+    double percentile[SUMMARY_MAX_PERCENTILES]; // 请求的百分位（0~100）
+    uint64_t percentile_len[SUMMARY_MAX_PERCENTILES];
+};
+
+/**
+ * 一次遍历直方图得到 top-K 长度、任意百分位、最小/最大长度、均值和标准差
+ * 第一级的 MAX_LEN 个计数按数组顺序处理，编译器可以向量化求和与平方和；百分位按前缀和定位（最近秩法）
+ * 多个文件的结果先用 line_histogram_merge 合并，再调用本函数
+ *
+ * @param hist 行长度直方图
+ * @param top_k 需要的最常见长度个数（按出现次数降序，次数相同时长度小的在前），最多 SUMMARY_MAX_TOP_K
+ * @param percentiles 百分位数组（0~100，无需有序），可为 NULL
+ * @param num_percentiles 百分位个数，最多 SUMMARY_MAX_PERCENTILES
+ * @param summary 输出：汇总结果
+ */
+void line_histogram_summary(const LineHistogram* hist, int top_k, const double* percentiles, int num_percentiles,
+                            LineSummary* summary);
+
+/**
+ * 把旧接口的 32 位统计转成两级直方图（line_num[MAX_LEN - 1] 仍表示 >= MAX_LEN - 1 的所有行），
+ * 便于对旧接口的结果使用 line_histogram_summary
+ */
+void line_histogram_from_legacy(LineHistogram* hist, uint32_t total_line_num, const uint32_t* line_num);
+
+/**
+ * 以文本形式输出汇总结果（每项一行）
+ */
+void print_line_summary(const LineSummary* summary);
+
+#endif
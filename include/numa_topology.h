@@ -0,0 +1,83 @@
+#ifndef _NUMA_TOPOLOGY_H
+#define _NUMA_TOPOLOGY_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+
+#define NUMA_MAX_NODES 64
+
+/**
+ * 一个 NUMA 节点：节点号和当前进程允许使用的CPU
+ */
+struct NumaNode {
+    int id;       // sysfs 中的节点号（不一定连续）
+    int num_cpus; // cpus 中的CPU个数
+    cpu_set_t cpus;
+};
+
+/**
+ * NUMA 拓扑：只包含有可用CPU的节点（纯内存节点和被 taskset/cgroup 排除的节点不计入）
+ */
+struct NumaTopology {
+    int num_nodes;
+    NumaNode nodes[NUMA_MAX_NODES];
+};
+
+enum NumaPlacement {
+    NUMA_PLACEMENT_AUTO, // 默认：检测到多个节点时绑核，单节点机器上保持原来的行为
+    NUMA_PLACEMENT_ON,   // 总是绑核（单节点时等价于绑到进程允许的全部CPU）
+    NUMA_PLACEMENT_OFF,  // 不绑核，线程和内存由内核调度（对比测试用）
+};
+
+/**
+ * 从 /sys/devices/system/node 读取拓扑（不依赖 libnuma），并与 sched_getaffinity 取交集
+ * sysfs 不可用时退化为包含全部可用CPU的单个节点
+ *
+ * @param topo 输出：拓扑
+ * @return 节点数（至少为1）
+ */
+int numa_topology_detect(NumaTopology* topo);
+
+/**
+ * 设置工作线程的放置策略（进程级，需在启动工作线程前调用）
+ */
+void numa_set_placement(NumaPlacement mode);
+
+/**
+ * 当前策略下使用的拓扑（首次调用时检测并缓存）
+ *
+ * @return 需要绑核时返回拓扑，否则返回 NULL
+ */
+const NumaTopology* numa_placement();
+
+/**
+ * 第 worker 个工作线程（共 num_workers 个）所属的节点下标
+ * 按各节点CPU数成比例分配连续编号的线程，相邻的线程（处理相邻的数据）落在同一节点
+ */
+int numa_worker_node(const NumaTopology* topo, int worker, int num_workers);
+
+/**
+ * 把调用线程绑定到第 worker 个工作线程对应节点的CPU上
+ * 绑定后再分配并首次写入的内存（first-touch）会落在该节点上
+ *
+ * @return 绑定的节点下标；策略为不绑核或绑定失败时返回 -1
+ */
+int numa_bind_worker(int worker, int num_workers);
+
+/**
+ * 调用线程当前所在CPU属于的节点下标（sched_getcpu）
+ *
+ * @return 节点下标；策略为不绑核或无法确定时返回 -1
+ */
+int numa_current_node();
+
+/**
+ * 把调用线程绑定到指定节点下标的CPU上
+ *
+ * @return 绑定的节点下标；策略为不绑核、下标无效或绑定失败时返回 -1
+ */
+int numa_bind_node(int node);
+
+#endif
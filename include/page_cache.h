@@ -0,0 +1,38 @@
+#ifndef _PAGE_CACHE_H
+#define _PAGE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 顺序扫描时提前提示内核预读的距离：读第 n 块时提示 n + READAHEAD_DISTANCE 处的数据
+#define READAHEAD_DISTANCE (4 << 20) // 4MB
+
+/**
+ * 用 mincore 统计文件当前有多少在页缓存中
+ *
+ * @param filepath 文件路径
+ * @param resident_bytes 输出（可为 NULL）：在页缓存中的字节数（按页计）
+ * @param file_bytes 输出（可为 NULL）：文件大小
+ * @return 驻留比例（0~1，空文件为1），失败返回 -1
+ */
+double page_cache_residency(const char* filepath, uint64_t* resident_bytes = NULL, uint64_t* file_bytes = NULL);
+
+/**
+ * 用 posix_fadvise(POSIX_FADV_DONTNEED) 把文件逐出页缓存，用于冷缓存测试（不需要 root）
+ * 脏页和被其他进程映射锁定的页不会被逐出，调用方可以再用 page_cache_residency 确认效果
+ *
+ * @return 成功返回0，失败返回 -1
+ */
+int page_cache_drop(const char* filepath);
+
+/**
+ * 提示内核预读 [offset, offset + size)（POSIX_FADV_WILLNEED），超出 end 的部分忽略
+ * 顺序扫描循环在开始时提示前 READAHEAD_DISTANCE 字节，之后每读一块提示 READAHEAD_DISTANCE 之后的同样大小，
+ * 预读窗口随扫描向前滑动；O_DIRECT 读取不经过页缓存，不应调用
+ *
+ * @param end 扫描终点，< 0 表示不限制
+ */
+void page_cache_readahead(int handle, off_t offset, size_t size, off_t end = -1);
+
+#endif
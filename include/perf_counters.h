@@ -0,0 +1,68 @@
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+
+#include <stddef.h>
+
+enum PerfEvent {
+    PERF_EVENT_CYCLES,
+    PERF_EVENT_INSTRUCTIONS,
+    PERF_EVENT_LLC_MISSES, // PERF_COUNT_HW_CACHE_MISSES，x86 上对应最后一级缓存缺失
+    PERF_EVENT_DTLB_MISSES, // dTLB 读缺失
+    PERF_EVENT_BRANCH_MISSES,
+    PERF_NUM_EVENTS,
+};
+
+/**
+ * 一组 perf_event_open 计数器（用户态、继承到之后创建的线程），每个事件单独打开，
+ * 虚拟机或容器里部分事件不可用时其余事件照常计数
+ */
+struct PerfCounters {
+    int fds[PERF_NUM_EVENTS]; // 不可用的事件为 -1
+};
+
+/**
+ * 一次测量的结果；计数器被复用（multiplex）时按启用/运行时间比例换算
+ */
+struct PerfSample {
+    bool valid[PERF_NUM_EVENTS];
+    double value[PERF_NUM_EVENTS];
+};
+
+/**
+ * 打开计数器（先不计数），需在创建被测线程之前调用
+ *
+ * @return 可用的事件数，0 表示没有硬件计数器（perf_event_paranoid 限制、虚拟机没有 PMU 等）
+ */
+int perf_counters_open(PerfCounters* counters);
+
+/**
+ * 清零并开始计数
+ */
+void perf_counters_start(PerfCounters* counters);
+
+/**
+ * 停止计数并读出结果（被测线程需已结束，它们的计数在退出时才累加回来）
+ */
+void perf_counters_stop(PerfCounters* counters, PerfSample* sample);
+
+void perf_counters_close(PerfCounters* counters);
+
+/**
+ * 每周期指令数，cycles 或 instructions 不可用时返回 -1
+ */
+double perf_sample_ipc(const PerfSample* sample);
+
+/**
+ * sum += sample * weight（用于多次测量取平均），某个事件在任一次测量中不可用则结果中也不可用
+ * sum 需先 perf_sample_clear
+ */
+void perf_sample_clear(PerfSample* sum);
+void perf_sample_accumulate(PerfSample* sum, const PerfSample* sample, double weight);
+
+/**
+ * 格式化为一行文本，例如 "cycles 1.23G instr 2.34G IPC 1.90 LLC-miss 1.2M dTLB-miss 3.4K br-miss 5.6K"，
+ * 不可用的事件输出 n/a
+ */
+void perf_sample_format(const PerfSample* sample, char* buffer, size_t size);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _RANGE_SCAN_H
+#define _RANGE_SCAN_H
+
+#include "line_histogram.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * 文件区间扫描的边界信息（分段多线程和批量分析共用）
+ * 一个区间独立扫描时，开头和结尾的半行要等相邻区间扫描完后再拼接
+ */
+struct RangeBoundary {
+    // 区间开头到第一个换行符之间的字节数，这部分属于上一个区间延续过来的行
+    bool has_newline;
+    uint64_t head_len;
+    // 最后一个换行符之后剩余的字节数，延续到下一个区间
+    uint64_t tail_len;
+};
+
+/**
+ * 扫描区间中的一段连续数据：第一个换行符之前的内容只累加到 boundary->head_len，
+ * 之后的完整行计入 hist
+ *
+ * @param cur_len 输入输出：跨数据块延续的当前行长度，区间扫描完后即为 tail_len
+ */
+void scan_range_data(RangeBoundary* boundary, const char* data, ssize_t size, LineHistogram* hist, uint64_t* cur_len);
+
+/**
+ * 用 pread 扫描文件区间 [start, end)
+ *
+ * @param handle 文件描述符（可以是 O_DIRECT 打开的）
+ * @param buffer 读缓冲区，长度 buffer_size，O_DIRECT 时需按 DIRECT_IO_ALIGN 对齐
+ * @param boundary 输出：区间边界信息（需先清零）
+ * @param hist 输入输出：区间内完整行的统计
+ * @return 整个区间都读到返回 true；读取出错或文件提前结束返回 false（已读部分仍计入 boundary 和 hist）
+ */
+bool scan_file_range(int handle, off_t start, off_t end, char* buffer, size_t buffer_size, RangeBoundary* boundary,
+                     LineHistogram* hist);
+
+/**
+ * 按文件顺序拼接各区间首尾的半行，拼出来的行计入 hist
+ * 与 filelines_baseline 一致：文件末尾没有换行符的最后一行不计入统计
+ *
+ * @param carry 第一个区间之前尚未结束的行长度（从文件中间续扫时使用）
+ * @return 最后一个换行符之后尚未结束的行长度
+ */
+uint64_t stitch_ranges(const RangeBoundary* boundaries, int num_ranges, LineHistogram* hist, uint64_t carry = 0);
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef _SIMD_KERNEL_H
+#define _SIMD_KERNEL_H
+
+#include "line_histogram.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * SIMD换行符统计内核（所有 filelines 版本共用）
+ * 程序启动时通过 cpuid 选择可用的最宽指令集：AVX-512BW（64字节）> AVX2（32字节）> SSE2（16字节），
+ * 同一个二进制可以在新旧不同的CPU上都跑满速度
+ * 设置环境变量 FILELINES_SIMD=sse2|avx2|avx512 可以强制使用指定版本（用于对比测试）
+ *
+ * @param buffer 数据块
+ * @param size 数据块字节数
+ * @param total_line_num 输入输出：总行数
+ * @param line_num 输入输出：各长度行的数量统计数组
+ * @param cur_len 输入输出：跨数据块延续的当前行长度
+ */
+void process_block_simd_opt(const char* buffer, ssize_t size, uint32_t* total_line_num, uint32_t* line_num,
+                            int* cur_len);
+
+/**
+ * 64位计数版本的内核：结果写入两级直方图，行长度不封顶
+ *
+ * @param buffer 数据块
+ * @param size 数据块字节数
+ * @param hist 输入输出：行长度直方图
+ * @param cur_len 输入输出：跨数据块延续的当前行长度
+ */
+void process_block_simd_wide(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len);
+
+/**
+ * 行偏移采样的接收端：内核每扫过 stride 行调用一次 record，传入下一行开头在文件中的偏移
+ * 由调用方初始化 stride、record 和其余字段（通常全为0，next_line 为 stride），内核负责更新计数字段
+ */
+struct LineOffsetSink {
+    uint64_t stride;    // 采样间隔（行数）
+    uint64_t lines;     // 已扫描的换行符数
+    uint64_t next_line; // 下一次采样的行号：扫过这么多换行符后记录一次
+    uint64_t offset;    // 下一个数据块在文件中的偏移
+    void (*record)(LineOffsetSink* sink, uint64_t line_offset);
+};
+
+/**
+ * 带行偏移采样的64位计数内核：统计结果与 process_block_simd_wide 相同，
+ * 同时利用同一个换行符位图在每个采样行处回调 sink->record
+ *
+ * @param buffer 数据块（必须是 sink->offset 处开始的连续数据）
+ * @param size 数据块字节数
+ * @param hist 输入输出：行长度直方图
+ * @param cur_len 输入输出：跨数据块延续的当前行长度
+ * @param sink 输入输出：采样状态
+ */
+void process_block_simd_indexed(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len,
+                                LineOffsetSink* sink);
+
+/**
+ * 在数据块中查找第 *n 个换行符（从1开始计数），找到后立即停止扫描
+ *
+ * @param n 输入输出：要跳过的换行符个数；没找到时减去本块中的换行符数，用于在下一块中继续查找
+ * @return 换行符在数据块中的下标，没找到返回 -1
+ */
+ssize_t find_nth_newline(const char* buffer, ssize_t size, uint64_t* n);
+
+#define MAX_DELIMITERS 8 // 半字节查表每个分隔符占一位，8位的表项最多区分8个字节
+
+/**
+ * 行分隔符集合，用 delimiter_set_init 初始化
+ */
+struct DelimiterSet {
+    uint8_t lo_lut[16]; // 低半字节查找表
+    uint8_t hi_lut[16]; // 高半字节查找表
+    uint8_t bytes[MAX_DELIMITERS];
+    int count;
+    bool crlf;          // 为 true 时分隔符前面紧挨着的 '\r' 不计入行长度
+    uint8_t table[256]; // 标量尾部处理用
+};
+
+/**
+ * 初始化分隔符集合（例如 "\n"、"\0"、"\x1e"，或它们的组合），重复的字节只计一次
+ *
+ * @param delimiters 分隔符字节
+ * @param count 字节数，超过 MAX_DELIMITERS 的部分被忽略；为0时使用 '\n'
+ * @param crlf CRLF 模式：行尾的 '\r' 不计入行长度（'\r' 本身在分隔符集合中时忽略）
+ */
+void delimiter_set_init(DelimiterSet* set, const char* delimiters, int count, bool crlf);
+
+/**
+ * 可配置分隔符的64位计数内核：只有一个分隔符时与 process_block_simd_wide 一样只做一次比较，
+ * 多个分隔符时用 pshufb 半字节查表分类（AVX2/AVX-512BW），每64字节只多两次查表
+ *
+ * @param buffer 数据块
+ * @param size 数据块字节数
+ * @param set 分隔符集合
+ * @param hist 输入输出：行长度直方图
+ * @param cur_len 输入输出：跨数据块延续的当前行长度
+ * @param prev_cr 输入输出：上一个数据块是否以 '\r' 结尾（CRLF 被数据块边界分开时使用）
+ */
+void process_block_simd_delim(const char* buffer, ssize_t size, const DelimiterSet* set, LineHistogram* hist,
+                              uint64_t* cur_len, bool* prev_cr);
+
+/**
+ * wc 风格的计数结果和跨数据块的状态，用 wc_counts_init 初始化
+ */
+struct WcCounts {
+    // 空白分隔的记号数（空白只有 ' ' 和 '\t' '\n' '\v' '\f' '\r'，其他字节都算记号内容），可能与 wc -w 不同：
+    // GNU wc 按语言环境区分可打印字符、控制字符和 Unicode 空白
+    uint64_t words;
+    uint64_t chars; // UTF-8 字符数：不是 10xxxxxx 后续字节的字节数（输入是合法 UTF-8 时与 wc -m 一致）
+    uint64_t bytes;
+    bool prev_space;    // 上一个数据块是否以空白结尾
+    bool codepoint_len; // 为 true 时直方图中的行长度按字符数而不是字节数统计
+};
+
+void wc_counts_init(WcCounts* counts, bool codepoint_len);
+
+/**
+ * 融合计数内核：一遍扫描同时得到行长度直方图、单词数、字符数和字节数，
+ * 每64字节在换行符位图之外再生成空白和 UTF-8 后续字节两个位图，用位运算和 popcount 计数
+ *
+ * @param buffer 数据块
+ * @param size 数据块字节数
+ * @param hist 输入输出：行长度直方图
+ * @param cur_len 输入输出：跨数据块延续的当前行长度（按字符计长度时为字符数）
+ * @param counts 输入输出：单词、字符、字节计数
+ */
+void process_block_simd_wc(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len,
+                           WcCounts* counts);
+
+#define CSV_MAX_COLUMNS 64 // 单独统计的列数，更多的列并入最后一列
+
+/**
+ * CSV/TSV 列统计结果和跨数据块的状态，用 csv_stats_init 初始化（约 600KB，需在堆上分配）
+ * 字段宽度是字段的原始字节数（包括包围字段的双引号和转义用的 ""），不包括分隔符、换行符和行尾的 '\r'
+ * 引号内的分隔符和换行符属于字段内容；空行不计为记录
+ */
+struct CsvStats {
+    char separator;
+    LineHistogram fields;                   // 每条记录的字段数分布，total_line_num 为记录数
+    LineHistogram columns[CSV_MAX_COLUMNS]; // 各列的字段宽度分布，第 CSV_MAX_COLUMNS 列包括其后所有列
+
+    // 跨数据块的状态
+    uint64_t field_len; // 当前字段已扫描的字节数
+    uint64_t column;    // 当前记录中已结束的字段数
+    bool in_quote;      // 上一个数据块结束时是否在引号内
+    bool prev_cr;       // 上一个数据块是否以 '\r' 结尾
+};
+
+void csv_stats_init(CsvStats* stats, char separator);
+
+/**
+ * CSV/TSV 列统计内核：每64字节生成换行符、分隔符、'\r' 和双引号四个位图，
+ * 引号位图与全1做无进位乘法（PCLMULQDQ）得到前缀异或，即"在引号内"的位图，
+ * 去掉引号内的分隔符和换行符后，和行统计一样用 ctz 逐个取出字段边界
+ *
+ * @param buffer 数据块
+ * @param size 数据块字节数
+ * @param stats 输入输出：列统计
+ */
+void process_block_simd_csv(const char* buffer, ssize_t size, CsvStats* stats);
+
+/**
+ * 结束统计：文件最后一条记录没有换行符时把它计入结果
+ */
+void csv_stats_finish(CsvStats* stats);
+
+/**
+ * 当前使用的内核指令集名称（"SSE2" / "AVX2" / "AVX-512BW"）
+ */
+const char* simd_kernel_name();
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _URING_READER_H
+#define _URING_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// 不在头文件中包含 <linux/io_uring.h>：它会引入 <linux/fs.h> 中的 BLOCK_SIZE 宏
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * 基于原始系统调用的最小 io_uring 封装（不依赖 liburing）
+ * 只提供文件读取需要的功能：提交读请求、注册缓冲区、收割完成事件
+ */
+struct UringReader {
+    int ring_fd;
+    unsigned sq_entries;
+    bool fixed_buffers; // 是否已注册固定缓冲区（可使用 READ_FIXED）
+
+    // 提交队列
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned sq_pending; // 已填写但还没有通过 io_uring_enter 提交的请求数
+
+    // 完成队列
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // 映射区域，销毁时释放
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+/**
+ * 创建 io_uring 实例
+ *
+ * @param reader 输出：初始化后的读取器
+ * @param entries 提交队列深度
+ * @return 成功返回0，失败返回负的 errno（例如内核不支持或被 seccomp 禁止）
+ */
+int uring_reader_init(UringReader* reader, unsigned entries);
+
+/**
+ * 注册固定缓冲区，之后可用 buf_index 发起 READ_FIXED，省去每次请求的页面固定开销
+ *
+ * @return 成功返回0，失败返回负的 errno（例如超出 RLIMIT_MEMLOCK），此时仍可使用普通读取
+ */
+int uring_reader_register_buffers(UringReader* reader, const struct iovec* iovecs, unsigned nr);
+
+/**
+ * 填写一个读请求（尚未提交），buf_index >= 0 且已注册固定缓冲区时使用 READ_FIXED
+ *
+ * @return 提交队列已满时返回 false
+ */
+bool uring_reader_prep_read(UringReader* reader, int fd, void* buf, unsigned len, off_t offset, int buf_index,
+                            uint64_t user_data);
+
+/**
+ * 提交所有已填写的请求，并至少等待 wait_nr 个完成事件
+ *
+ * @return 成功返回0，失败返回负的 errno
+ */
+int uring_reader_submit(UringReader* reader, unsigned wait_nr);
+
+/**
+ * 取出一个完成事件（非阻塞）
+ *
+ * @param user_data 输出：请求的 user_data
+ * @param res 输出：读取的字节数或负的 errno
+ * @return 没有完成事件时返回 false
+ */
+bool uring_reader_pop(UringReader* reader, uint64_t* user_data, int* res);
+
+void uring_reader_destroy(UringReader* reader);
+
+#endif
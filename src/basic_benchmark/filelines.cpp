@@ -1,25 +1,356 @@
-
+#include "filelines_autotune.h"
+#include "filelines_checkpoint.h"
 #include "filelines_mt.h"
+#include "filelines_sample.h"
+#include "filelines_simd_opt.h"
+#include "filelines_stream.h"
 #include "find_most_freq.h"
+#include "huge_pages.h"
+#include "line_index.h"
+#include "line_summary.h"
+#include "numa_topology.h"
+#include "simd_kernel.h"
 
 #include <cstdint>
+#include <ctype.h>
+#include <fcntl.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 输出第 line_no 行（从1开始），索引不存在或已过期时先重建
+static int print_line(const char* filepath, const char* index_path, uint64_t line_no) {
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    LineIndex index;
+    if (line_index_open(&index, index_path, handle) < 0 &&
+        (line_index_build(filepath, index_path) < 0 || line_index_open(&index, index_path, handle) < 0)) {
+        close(handle);
+        return -1;
+    }
+
+    off_t offset = line_no > 0 ? line_index_seek(&index, handle, line_no - 1) : -1;
+    line_index_close(&index);
+    if (offset < 0) {
+        close(handle);
+        return -1;
+    }
+
+    char buffer[4096];
+    while (1) {
+        ssize_t bytes_read = pread(handle, buffer, sizeof(buffer), offset);
+        if (bytes_read <= 0)
+            break;
+        const char* newline = (const char*)memchr(buffer, '\n', bytes_read);
+        fwrite(buffer, 1, newline ? newline - buffer : bytes_read, stdout);
+        if (newline)
+            break;
+        offset += bytes_read;
+    }
+    putchar('\n');
+    close(handle);
+    return 0;
+}
+
+// 解析分隔符参数，支持 \n \r \t \0 \\ 和 \xHH 转义，返回字节数
+static int parse_delimiters(const char* arg, char* out) {
+    int count = 0;
+    for (const char* p = arg; *p && count < MAX_DELIMITERS; p++) {
+        char c = *p;
+        if (c == '\\' && p[1]) {
+            p++;
+            switch (*p) {
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case '0': c = '\0'; break;
+            case 'x':
+                if (isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+                    char hex[3] = {p[1], p[2], 0};
+                    c = (char)strtol(hex, NULL, 16);
+                    p += 2;
+                } else {
+                    c = 'x';
+                }
+                break;
+            default: c = *p; break;
+            }
+        }
+        out[count++] = c;
+    }
+    return count;
+}
+
+// --summary 输出的分布统计
+static void print_summary(const LineHistogram* hist) {
+    const double percentiles[] = {50, 90, 99, 99.9};
+    LineSummary summary;
+    line_histogram_summary(hist, 5, percentiles, 4, &summary);
+    print_line_summary(&summary);
+}
+
+// --csv/--tsv 的输出：记录数和字段数范围，然后每列一行宽度统计
+static int print_csv_stats(char* filepath, char separator, bool from_stdin) {
+    CsvStats* stats = (CsvStats*)malloc(sizeof(CsvStats));
+    if (!stats)
+        return -1;
+    csv_stats_init(stats, separator);
+    if (from_stdin)
+        filelines_stream_csv(STDIN_FILENO, stats);
+    else
+        filelines_simd_csv(filepath, stats);
+
+    const double percentiles[] = {50, 99};
+    LineSummary summary;
+    line_histogram_summary(&stats->fields, 0, NULL, 0, &summary);
+    printf("rows %" PRIu64 " fields %" PRIu64 "-%" PRIu64 "\n", summary.total_line_num, summary.min_len,
+           summary.max_len);
+    for (int k = 0; k < CSV_MAX_COLUMNS; k++) {
+        if (stats->columns[k].total_line_num == 0)
+            break;
+        line_histogram_summary(&stats->columns[k], 0, percentiles, 2, &summary);
+        printf("col %d%s count %" PRIu64 " min %" PRIu64 " max %" PRIu64 " mean %.2f p50 %" PRIu64 " p99 %" PRIu64
+               "\n",
+               k + 1, k == CSV_MAX_COLUMNS - 1 ? "+" : "", summary.total_line_num, summary.min_len, summary.max_len,
+               summary.mean, summary.percentile_len[0], summary.percentile_len[1]);
+    }
+    free(stats);
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Usage: %s filepath", argv[0]);
+    // 用法: filelines [-j threads] [--mmap] [--uring [-q depth]] [--wide] [--checkpoint file] [--index file [--line N]] [-d delims] [--crlf] [--wc [--chars]] [--summary] [--csv|--tsv] [--autotune] [--sample K] [--numa|--no-numa] [--hugepages] filepath
+    // 不带 -j 时使用生产者-消费者版本；带 -j 时使用分段多线程版本（0 表示按CPU核数）
+    // --mmap 改为映射文件直接扫描；--uring 使用 io_uring 异步读取，-q 指定在途请求数
+    // --wide 使用64位计数（超过 40 亿行的文件），长度 >= MAX_LEN 的行不再并入最后一个桶
+    // filepath 为 "-" 时从标准输入流式读取（例如 zcat x.gz | filelines -），此时忽略 -j/--mmap/--uring，支持 -d/--crlf 和 --wc
+    // --checkpoint 增量分析追加写入的日志：从检查点记录的位置续扫新增部分，并更新检查点（不能与 --wc/-d/--crlf 或 "-" 同时使用）
+    // --index 扫描的同时建立行偏移索引；再加 --line N 时不做统计，借助索引直接输出第 N 行（从1开始）
+    // （不能与 --checkpoint/--wc/-d/--crlf 或 "-" 同时使用，--line 必须和 --index 一起使用）
+    // -d 指定行分隔符（最多8个字节，如 '\n\0\x1e'）；--crlf 时行尾的 '\r' 不计入长度
+    // --wc 同一遍扫描额外输出 "行数 单词数 字符数 字节数"（单词数为空白分隔的记号数，可能与 wc -w 不同；按 '\n' 分行，不能与 -d/--crlf 同时使用）；--chars 时行长度按 UTF-8 字符数统计（需要 --wc）
+    // --summary 额外输出最小/最大/均值/标准差、p50/p90/p99/p99.9 和出现最多的5种长度
+    // --csv/--tsv 改为列统计模式：输出记录数、字段数范围和每列字段宽度的最小/最大/均值/p50/p99（识别双引号），
+    // 支持 "-"，不能与 --wide/--checkpoint/--index/-d/--crlf/--wc/--summary 同时使用
+    // --autotune 在文件开头 256MB 上探测最佳块大小和队列大小，按设备保存到 $HOME/.filelines_tune（或 $FILELINES_TUNE_CACHE）；
+    // 之后默认的生产者-消费者版本自动使用该设备保存的参数
+    // --sample K 只随机读取 K 个 256KB 块，外推出估计的统计结果（输出格式不变），置信区间输出到 stderr；
+    // 只支持默认的32位统计，不能与 --wide/--checkpoint/--index/-d/--crlf/--wc/--csv/--tsv 或 "-" 同时使用，并忽略 -j/--mmap/--uring
+    // --numa/--no-numa 强制打开/关闭多线程版本的 NUMA 绑核（默认只在多节点机器上绑核）
+    // --hugepages 读缓冲区改用大页（MAP_HUGETLB，不可用时退回透明大页）
+    int num_threads = -1;
+    bool use_mmap = false;
+    bool wide = false;
+    bool use_uring = false;
+    int queue_depth = 0;
+    char* checkpoint_path = NULL;
+    char* index_path = NULL;
+    uint64_t line_no = 0;
+    char delims[MAX_DELIMITERS];
+    int num_delims = 0;
+    bool crlf = false;
+    bool wc = false;
+    bool codepoint_len = false;
+    bool summary = false;
+    char csv_separator = 0;
+    bool autotune = false;
+    int sample_chunks = 0;
+    char* filepath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            use_mmap = true;
+        } else if (strcmp(argv[i], "--wide") == 0) {
+            wide = true;
+        } else if (strcmp(argv[i], "--uring") == 0) {
+            use_uring = true;
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            index_path = argv[++i];
+        } else if (strcmp(argv[i], "--line") == 0 && i + 1 < argc) {
+            line_no = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            num_delims = parse_delimiters(argv[++i], delims);
+        } else if (strcmp(argv[i], "--crlf") == 0) {
+            crlf = true;
+        } else if (strcmp(argv[i], "--wc") == 0) {
+            wc = true;
+        } else if (strcmp(argv[i], "--chars") == 0) {
+            codepoint_len = true;
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            summary = true;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            csv_separator = ',';
+        } else if (strcmp(argv[i], "--tsv") == 0) {
+            csv_separator = '\t';
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = true;
+        } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+            sample_chunks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            numa_set_placement(NUMA_PLACEMENT_ON);
+        } else if (strcmp(argv[i], "--no-numa") == 0) {
+            numa_set_placement(NUMA_PLACEMENT_OFF);
+        } else if (strcmp(argv[i], "--hugepages") == 0) {
+            huge_pages_set_enabled(true);
+        } else if (filepath == NULL) {
+            filepath = argv[i];
+        } else {
+            filepath = NULL;
+            break;
+        }
+    }
+    if (filepath == NULL) {
+        printf("Usage: %s [-j threads] [--mmap] [--uring [-q depth]] [--wide] [--checkpoint file] [--index file [--line N]] "
+               "[-d delims] [--crlf] [--wc [--chars]] [--summary] [--csv|--tsv] [--autotune] [--sample K] "
+               "[--numa|--no-numa] [--hugepages] filepath|-",
+               argv[0]);
         return -1;
     }
+
+    bool from_stdin = strcmp(filepath, "-") == 0;
+
+    if (sample_chunks > 0 &&
+        (wide || checkpoint_path || index_path || num_delims > 0 || crlf || wc || csv_separator || from_stdin)) {
+        fprintf(stderr, "--sample cannot be combined with --wide, --checkpoint, --index, -d, --crlf, --wc, "
+                        "--csv/--tsv or stdin\n");
+        return -1;
+    }
+    if (checkpoint_path && (wc || num_delims > 0 || crlf || from_stdin)) {
+        fprintf(stderr, "--checkpoint cannot be combined with --wc, -d, --crlf or stdin\n");
+        return -1;
+    }
+    if (index_path && (checkpoint_path || wc || num_delims > 0 || crlf || from_stdin)) {
+        fprintf(stderr, "--index cannot be combined with --checkpoint, --wc, -d, --crlf or stdin\n");
+        return -1;
+    }
+    if (line_no > 0 && !index_path) {
+        fprintf(stderr, "--line requires --index\n");
+        return -1;
+    }
+    if (codepoint_len && !wc) {
+        fprintf(stderr, "--chars requires --wc\n");
+        return -1;
+    }
+    if (wc && (num_delims > 0 || crlf)) {
+        fprintf(stderr, "--wc cannot be combined with -d or --crlf\n");
+        return -1;
+    }
+    if (csv_separator && (wide || checkpoint_path || index_path || num_delims > 0 || crlf || wc || summary)) {
+        fprintf(stderr, "--csv/--tsv cannot be combined with --wide, --checkpoint, --index, -d, --crlf, --wc or "
+                        "--summary\n");
+        return -1;
+    }
+
+    if (index_path && line_no > 0)
+        return print_line(filepath, index_path, line_no);
+    if (csv_separator)
+        return print_csv_stats(filepath, csv_separator, from_stdin);
+
+    DelimiterSet delimiters;
+    bool use_delim = num_delims > 0 || crlf;
+    if (use_delim)
+        delimiter_set_init(&delimiters, delims, num_delims, crlf);
+
     uint32_t line_num[MAX_LEN];
     for (int i = 0; i < MAX_LEN; i++)
         line_num[i] = 0;
     uint32_t total_line_num = 0;
 
-    filelines_mt(argv[1], &total_line_num, line_num);
+    WcCounts counts;
+    wc_counts_init(&counts, codepoint_len);
+
+    // 检查点、索引、自定义分隔符和 wc 只有64位直方图版本，不带 --wide 时折算成32位结果输出
+    if (wide || checkpoint_path || index_path || use_delim || wc) {
+        LineHistogram hist;
+        line_histogram_init(&hist);
+        if (wc && from_stdin)
+            filelines_stream_wc(STDIN_FILENO, &hist, &counts);
+        else if (wc)
+            filelines_simd_wc(filepath, &hist, &counts);
+        else if (from_stdin)
+            filelines_stream_wide(STDIN_FILENO, &hist, use_delim ? &delimiters : NULL);
+        else if (use_delim)
+            filelines_simd_delim(filepath, &delimiters, &hist);
+        else if (checkpoint_path) {
+            if (filelines_incremental(filepath, checkpoint_path, &hist, num_threads > 0 ? num_threads : 0) < 0) {
+                fprintf(stderr, "checkpoint: failed to read %s, checkpoint not updated\n", filepath);
+                return 1;
+            }
+        }
+        else if (index_path) {
+            if (line_index_build(filepath, index_path, &hist) < 0) {
+                fprintf(stderr, "index: failed to build %s from %s\n", index_path, filepath);
+                return 1;
+            }
+        }
+        else if (!filelines_mt_split_wide(filepath, &hist, num_threads > 0 ? num_threads : 0, use_mmap)) {
+            fprintf(stderr, "failed to read %s\n", filepath);
+            return 1;
+        }
+
+        if (wide) {
+            uint64_t most_freq_len, most_freq_len_linenum;
+            find_most_freq_line64(&hist, &most_freq_len, &most_freq_len_linenum);
+            printf("%" PRIu64 " %" PRIu64 " %" PRIu64 "\n", hist.total_line_num, most_freq_len, most_freq_len_linenum);
+            if (wc)
+                printf("%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", hist.total_line_num, counts.words,
+                       counts.chars, counts.bytes);
+            if (summary)
+                print_summary(&hist);
+            return 0;
+        }
+        line_histogram_to_legacy(&hist, &total_line_num, line_num);
+    } else if (from_stdin) {
+        filelines_stream(STDIN_FILENO, &total_line_num, line_num);
+    } else if (sample_chunks > 0) {
+        SampleEstimate estimate;
+        filelines_sample(filepath, &total_line_num, line_num, &estimate, sample_chunks);
+        uint32_t most_freq_len, most_freq_len_linenum;
+        find_most_freq_line(line_num, &most_freq_len, &most_freq_len_linenum);
+        if (estimate.num_chunks > 0)
+            fprintf(stderr, "sample: %d chunks, %.1f of %.1f MB, lines +-%.0f, mode count +-%.0f (95%%)\n",
+                    estimate.num_chunks, estimate.sampled_bytes / (1024.0 * 1024.0),
+                    estimate.file_size / (1024.0 * 1024.0), estimate.total_line_num_ci,
+                    estimate.line_num_ci[most_freq_len]);
+        else
+            fprintf(stderr, "sample: file smaller than the sample, scanned exactly\n");
+    } else if (num_threads >= 0) {
+        if (!filelines_mt_split(filepath, &total_line_num, line_num, num_threads, use_mmap)) {
+            fprintf(stderr, "failed to read %s\n", filepath);
+            return 1;
+        }
+    } else if (use_uring) {
+        filelines_mt_uring(filepath, &total_line_num, line_num, queue_depth);
+    } else if (use_mmap) {
+        filelines_simd_mmap(filepath, &total_line_num, line_num);
+    } else {
+        TuneConfig tune;
+        if (autotune && filelines_autotune(filepath, &tune, 0, true) == 0)
+            fprintf(stderr, "autotune: block %uKB queue %u (%.1f MB/s) -> %s\n", tune.block_size >> 10,
+                    tune.queue_size, tune.throughput, autotune_cache_path());
+        if (autotune_lookup(filepath, &tune) == 0)
+            filelines_mt_config(filepath, &total_line_num, line_num, tune.block_size, tune.queue_size);
+        else
+            filelines_mt(filepath, &total_line_num, line_num);
+    }
 
     uint32_t most_freq_len, most_freq_len_linenum;
     find_most_freq_line(line_num, &most_freq_len, &most_freq_len_linenum);
     printf("%d %d %d\n", total_line_num, most_freq_len, most_freq_len_linenum);
+    if (wc)
+        printf("%d %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", total_line_num, counts.words, counts.chars, counts.bytes);
+    if (summary) {
+        LineHistogram hist;
+        line_histogram_from_legacy(&hist, total_line_num, line_num);
+        print_summary(&hist);
+    }
 }
@@ -0,0 +1,133 @@
+/*
+ * 批量文件行分析程序
+ * 一次进程启动、一个线程池分析整个目录或文件列表，避免逐个文件启动 filelines 的进程和线程开销
+ * --pipeline 改用协程流水线：少量线程上交错处理多个文件，每个文件的读取、统计、校验是 co_await 衔接的阶段
+ */
+
+#include "filelines_batch.h"
+#include "filelines_pipeline.h"
+#include "line_summary.h"
+
+#include <chrono>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void print_result(const char* name, const LineHistogram* hist, const uint32_t* crc = NULL) {
+    uint64_t most_freq_len, most_freq_len_linenum;
+    find_most_freq_line64(hist, &most_freq_len, &most_freq_len_linenum);
+    printf("%s %" PRIu64 " %" PRIu64 " %" PRIu64, name, hist->total_line_num, most_freq_len, most_freq_len_linenum);
+    if (crc)
+        printf(" %08x", *crc);
+    printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    // 用法: filelines_batch [-j threads] [-l list_file] [--summary] [--pipeline [-f files] [--crc]] [path ...]
+    // path 可以是文件或目录（递归展开）；-l 从列表文件读取路径，每行一个，"-" 表示标准输入
+    // 每个文件输出一行 "路径 总行数 最常见行长度 该长度的行数"，最后输出汇总
+    // --summary 对合并后的直方图额外输出分布统计（百分位、均值、标准差、top-5 长度）
+    // --pipeline 使用协程流水线（io_uring 异步读），-f 指定每个线程同时处理的文件数；
+    // --crc 在流水线中增加 CRC32C 校验阶段，每个文件的结果后面追加校验值（隐含 --pipeline）
+    int num_threads = 0;
+    bool pipeline = false;
+    int files_in_flight = 0;
+    bool crc = false;
+    vector<string> files;
+    bool has_input = false;
+    bool summary = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            summary = true;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = true;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            files_in_flight = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--crc") == 0) {
+            pipeline = true;
+            crc = true;
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            has_input = true;
+            if (batch_read_list(argv[++i], &files) < 0) {
+                fprintf(stderr, "无法读取文件列表: %s\n", argv[i]);
+                return -1;
+            }
+        } else {
+            has_input = true;
+            // 无法访问的路径也保留，结果中标记为 error
+            if (batch_collect_path(argv[i], &files) < 0)
+                files.push_back(argv[i]);
+        }
+    }
+    if (!has_input) {
+        printf("Usage: %s [-j threads] [-l list_file] [--summary] [--pipeline [-f files] [--crc]] [path ...]\n",
+               argv[0]);
+        return -1;
+    }
+
+    LineHistogram* aggregate = (LineHistogram*)malloc(sizeof(LineHistogram));
+    if (!aggregate)
+        return -1;
+    line_histogram_init(aggregate);
+    vector<BatchFileResult> results;
+    vector<uint32_t> crcs;
+    bool used_uring = false;
+
+    auto start = chrono::high_resolution_clock::now();
+    if (pipeline) {
+        results.resize(files.size());
+        crcs.resize(files.size());
+        HistogramStage hist_stage;
+        ChecksumStage crc_stage;
+        histogram_stage_init(&hist_stage, &results);
+        checksum_stage_init(&crc_stage, &crcs);
+        vector<PipelineStage*> stages = {&hist_stage.base};
+        if (crc)
+            stages.push_back(&crc_stage.base);
+        used_uring = filelines_pipeline(files, stages, num_threads, files_in_flight);
+        for (size_t i = 0; i < results.size(); i++) {
+            results[i].filepath = files[i];
+            if (results[i].ok)
+                line_histogram_merge(aggregate, &results[i].hist);
+        }
+    } else {
+        filelines_batch(files, &results, aggregate, num_threads);
+    }
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double> duration = end - start;
+
+    uint64_t total_bytes = 0;
+    int failed = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!results[i].ok) {
+            printf("%s error\n", results[i].filepath.c_str());
+            failed++;
+            continue;
+        }
+        total_bytes += results[i].file_size;
+        print_result(results[i].filepath.c_str(), &results[i].hist, crc ? &crcs[i] : NULL);
+    }
+    print_result("[total]", aggregate);
+    if (summary) {
+        const double percentiles[] = {50, 90, 99, 99.9};
+        LineSummary line_summary;
+        line_histogram_summary(aggregate, 5, percentiles, 4, &line_summary);
+        print_line_summary(&line_summary);
+    }
+
+    double mb = total_bytes / (1024.0 * 1024.0);
+    fprintf(stderr, "files: %zu (failed %d), size: %.2f MB, time: %.3f s, throughput: %.2f MB/s%s\n",
+            results.size(), failed, mb, duration.count(), duration.count() > 0 ? mb / duration.count() : 0.0,
+            pipeline ? (used_uring ? " [pipeline, io_uring]" : " [pipeline, pread]") : "");
+
+    free(aggregate);
+    return failed > 0 ? 1 : 0;
+}
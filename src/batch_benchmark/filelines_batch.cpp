@@ -0,0 +1,317 @@
+#include "filelines_batch.h"
+
+#include "direct_io.h"
+#include "range_scan.h"
+
+#include <algorithm>
+#include <deque>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BATCH_BLOCK_SIZE (256 << 10) // 256KB，与 filelines_mt 相同的读取粒度
+#define BATCH_CHUNK_SIZE (16 << 20)  // 大文件按 16MB 切成多个任务，单个任务不会拖住整个批次
+
+// 一个任务：某个文件的一个字节区间 [start, end)
+struct BatchTask {
+    int file_index;
+    int chunk_index;
+    off_t start;
+    off_t end;
+};
+
+// 每个工作线程一个任务队列：自己从头部取，其他线程从尾部窃取
+struct WorkerQueue {
+    pthread_mutex_t lock;
+    std::deque<BatchTask> tasks;
+};
+
+// 文件级的合并状态
+struct BatchFileState {
+    pthread_mutex_t lock; // 多个区间任务并发合并到同一个文件的直方图时使用
+    int num_chunks;
+    RangeBoundary* boundaries;
+};
+
+struct BatchContext {
+    std::vector<BatchFileResult>* results;
+    BatchFileState* files;
+    WorkerQueue* queues;
+    int num_workers;
+};
+
+struct WorkerArg {
+    BatchContext* ctx;
+    int worker_id;
+};
+
+static bool pop_own_task(WorkerQueue* queue, BatchTask* task) {
+    bool found = false;
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->tasks.empty()) {
+        *task = queue->tasks.front();
+        queue->tasks.pop_front();
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool steal_task(WorkerQueue* queue, BatchTask* task) {
+    bool found = false;
+    pthread_mutex_lock(&queue->lock);
+    if (!queue->tasks.empty()) {
+        *task = queue->tasks.back();
+        queue->tasks.pop_back();
+        found = true;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+// 任务在开始前全部分配好，运行中不会产生新任务，所以所有队列都取不到任务时即可退出
+static bool next_task(BatchContext* ctx, int worker_id, BatchTask* task) {
+    if (pop_own_task(&ctx->queues[worker_id], task))
+        return true;
+    for (int i = 1; i < ctx->num_workers; i++) {
+        if (steal_task(&ctx->queues[(worker_id + i) % ctx->num_workers], task))
+            return true;
+    }
+    return false;
+}
+
+static void* batch_worker(void* arg) {
+    BatchContext* ctx = ((WorkerArg*)arg)->ctx;
+    int worker_id = ((WorkerArg*)arg)->worker_id;
+
+    char* buffer = alloc_io_buffer(BATCH_BLOCK_SIZE);
+    LineHistogram* scratch = (LineHistogram*)malloc(sizeof(LineHistogram));
+    if (!buffer || !scratch) {
+        // 不能直接退出：本线程队列中的任务还要靠其他线程窃取，这里让出即可
+        free(buffer);
+        free(scratch);
+        return NULL;
+    }
+
+    BatchTask task;
+    while (next_task(ctx, worker_id, &task)) {
+        BatchFileResult* result = &(*ctx->results)[task.file_index];
+        BatchFileState* state = &ctx->files[task.file_index];
+
+        int handle = open_for_scan(result->filepath.c_str(), false);
+        if (handle < 0) {
+            pthread_mutex_lock(&state->lock);
+            result->ok = false;
+            pthread_mutex_unlock(&state->lock);
+            continue;
+        }
+
+        RangeBoundary* boundary = &state->boundaries[task.chunk_index];
+        bool scanned;
+        if (state->num_chunks == 1) {
+            // 整个文件只有一个任务，没有其他线程写这个直方图，直接统计进去
+            scanned = scan_file_range(handle, task.start, task.end, buffer, BATCH_BLOCK_SIZE, boundary, &result->hist);
+            if (!scanned) {
+                pthread_mutex_lock(&state->lock);
+                result->ok = false;
+                pthread_mutex_unlock(&state->lock);
+            }
+        } else {
+            line_histogram_init(scratch);
+            scanned = scan_file_range(handle, task.start, task.end, buffer, BATCH_BLOCK_SIZE, boundary, scratch);
+            pthread_mutex_lock(&state->lock);
+            // 读取出错或文件在扫描期间被截断：区间不完整，边界也无法和相邻区间拼接
+            if (scanned)
+                line_histogram_merge(&result->hist, scratch);
+            else
+                result->ok = false;
+            pthread_mutex_unlock(&state->lock);
+        }
+        close(handle);
+    }
+
+    free(buffer);
+    free(scratch);
+    return NULL;
+}
+
+static int collect_path(const std::string& path, std::vector<std::string>* files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0)
+        return -1;
+    if (!S_ISDIR(st.st_mode)) {
+        files->push_back(path);
+        return 0;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (!dir)
+        return -1;
+    std::vector<std::string> entries;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        entries.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    // readdir 的顺序取决于文件系统，排序后输出稳定
+    std::sort(entries.begin(), entries.end());
+    std::string prefix = path;
+    if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+        prefix += '/';
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::string child = prefix + entries[i];
+        struct stat child_st;
+        if (stat(child.c_str(), &child_st) < 0)
+            continue;
+        // 跳过设备文件、管道等
+        if (S_ISDIR(child_st.st_mode))
+            collect_path(child, files);
+        else if (S_ISREG(child_st.st_mode))
+            files->push_back(child);
+    }
+    return 0;
+}
+
+int batch_collect_path(const char* path, std::vector<std::string>* files) {
+    return collect_path(path, files);
+}
+
+int batch_read_list(const char* list_file, std::vector<std::string>* files) {
+    FILE* fp = strcmp(list_file, "-") == 0 ? stdin : fopen(list_file, "r");
+    if (!fp)
+        return -1;
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    while ((len = getline(&line, &capacity, fp)) != -1) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+        if (len == 0)
+            continue;
+        // 无法访问的路径也保留，由分析阶段报告失败
+        if (collect_path(line, files) < 0)
+            files->push_back(line);
+    }
+    free(line);
+
+    if (fp != stdin)
+        fclose(fp);
+    return 0;
+}
+
+void filelines_batch(const std::vector<std::string>& files, std::vector<BatchFileResult>* results,
+                     LineHistogram* aggregate, int num_threads) {
+    int num_files = (int)files.size();
+    results->clear();
+    results->resize(num_files);
+    if (num_files == 0)
+        return;
+
+    BatchFileState* states = (BatchFileState*)calloc(num_files, sizeof(BatchFileState));
+    if (!states)
+        return;
+
+    // 先取得所有文件大小，切分任务
+    std::vector<BatchTask> tasks;
+    for (int i = 0; i < num_files; i++) {
+        BatchFileResult* result = &(*results)[i];
+        result->filepath = files[i];
+        result->file_size = 0;
+        line_histogram_init(&result->hist);
+        pthread_mutex_init(&states[i].lock, NULL);
+
+        struct stat st;
+        if (stat(files[i].c_str(), &st) < 0 || !S_ISREG(st.st_mode)) {
+            result->ok = false;
+            continue;
+        }
+        result->ok = true;
+        result->file_size = st.st_size;
+
+        off_t num_chunks = (st.st_size + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+        states[i].num_chunks = (int)num_chunks;
+        if (num_chunks == 0)
+            continue;
+        states[i].boundaries = (RangeBoundary*)calloc(num_chunks, sizeof(RangeBoundary));
+        if (!states[i].boundaries) {
+            result->ok = false;
+            continue;
+        }
+        for (off_t c = 0; c < num_chunks; c++) {
+            BatchTask task;
+            task.file_index = i;
+            task.chunk_index = (int)c;
+            task.start = c * BATCH_CHUNK_SIZE;
+            task.end = (c + 1) * BATCH_CHUNK_SIZE < st.st_size ? (c + 1) * BATCH_CHUNK_SIZE : st.st_size;
+            tasks.push_back(task);
+        }
+    }
+
+    // 大任务排在前面（最长处理时间优先），最后剩下的都是小任务，便于尾部均衡
+    std::stable_sort(tasks.begin(), tasks.end(), [&](const BatchTask& a, const BatchTask& b) {
+        return a.end - a.start > b.end - b.start;
+    });
+
+    if (num_threads <= 0)
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_threads > (int)tasks.size())
+        num_threads = tasks.empty() ? 1 : (int)tasks.size();
+
+    WorkerQueue* queues = new WorkerQueue[num_threads];
+    for (int t = 0; t < num_threads; t++)
+        pthread_mutex_init(&queues[t].lock, NULL);
+    // 轮流分配，每个队列都是从大到小排列
+    for (size_t i = 0; i < tasks.size(); i++)
+        queues[i % num_threads].tasks.push_back(tasks[i]);
+
+    BatchContext ctx;
+    ctx.results = results;
+    ctx.files = states;
+    ctx.queues = queues;
+    ctx.num_workers = num_threads;
+
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    WorkerArg* args = (WorkerArg*)malloc(num_threads * sizeof(WorkerArg));
+    if (threads && args) {
+        for (int t = 0; t < num_threads; t++) {
+            args[t].ctx = &ctx;
+            args[t].worker_id = t;
+            pthread_create(&threads[t], NULL, batch_worker, &args[t]);
+        }
+        for (int t = 0; t < num_threads; t++)
+            pthread_join(threads[t], NULL);
+    }
+    // 线程创建失败或所有线程都分配不到缓冲区时，队列中会剩下没有执行的任务，对应文件算作失败
+    for (int t = 0; t < num_threads; t++) {
+        for (const BatchTask& task : queues[t].tasks)
+            (*results)[task.file_index].ok = false;
+    }
+
+    // 拼接各文件跨区间的半行，再合并到总结果；失败的文件不保留部分统计
+    for (int i = 0; i < num_files; i++) {
+        BatchFileResult* result = &(*results)[i];
+        if (result->ok && states[i].num_chunks > 0) {
+            stitch_ranges(states[i].boundaries, states[i].num_chunks, &result->hist);
+            line_histogram_merge(aggregate, &result->hist);
+        } else if (!result->ok) {
+            line_histogram_init(&result->hist);
+        }
+        free(states[i].boundaries);
+        pthread_mutex_destroy(&states[i].lock);
+    }
+
+    for (int t = 0; t < num_threads; t++)
+        pthread_mutex_destroy(&queues[t].lock);
+    delete[] queues;
+    free(threads);
+    free(args);
+    free(states);
+}
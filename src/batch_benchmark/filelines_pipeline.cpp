@@ -0,0 +1,459 @@
+#include "filelines_pipeline.h"
+
+#include "direct_io.h"
+#include "simd_kernel.h"
+#include "uring_reader.h"
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <errno.h>
+#include <exception>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// 本文件使用 C++20 协程，需要单独以 -std=c++20 编译；头文件不暴露协程类型
+
+// 事件循环线程共享的状态：文件按顺序领取
+struct PipelineContext {
+    const std::vector<std::string>* files;
+    const std::vector<PipelineStage*>* stages;
+    std::atomic<size_t> next_file;
+    int files_in_flight;
+    std::atomic<bool> used_uring;
+};
+
+// 一次读取，在流水线各阶段之间传递
+struct PipelineBlock {
+    char* data;
+    size_t size;
+};
+
+struct EventLoop;
+struct ReadAwaitable;
+
+// 即发即弃的协程：创建后挂起，由事件循环调度；结束时自行销毁
+struct PipelineTask {
+    struct promise_type {
+        PipelineTask get_return_object() {
+            return PipelineTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+// 单线程事件循环：就绪队列 + io_uring 完成事件
+struct EventLoop {
+    PipelineContext* ctx;
+    UringReader ring;
+    bool use_uring;
+    std::unordered_set<ReadAwaitable*> in_flight; // 已填写但尚未完成的读请求
+    int active_files;
+    std::deque<std::coroutine_handle<>> ready;
+
+    void schedule(std::coroutine_handle<> handle) { ready.push_back(handle); }
+};
+
+static void fall_back_to_pread(EventLoop* loop);
+
+// 一个异步读请求：await_suspend 时提交，完成后由事件循环恢复等待的协程
+struct ReadAwaitable {
+    EventLoop* loop;
+    int fd;
+    char* buffer;
+    size_t size;
+    off_t offset;
+    int result;
+    std::coroutine_handle<> waiter;
+
+    bool await_ready() {
+        if (loop->use_uring)
+            return false;
+        // 没有 io_uring 时同步读取，不挂起
+        ssize_t bytes_read = pread(fd, buffer, size, offset);
+        result = bytes_read < 0 ? -errno : (int)bytes_read;
+        return true;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter = handle;
+        // 提交队列满时先把已填写的请求提交出去
+        while (!uring_reader_prep_read(&loop->ring, fd, buffer, (unsigned)size, offset, -1, (uint64_t)this)) {
+            if (uring_reader_submit(&loop->ring, 0) < 0) {
+                fall_back_to_pread(loop);
+                ssize_t bytes_read = pread(fd, buffer, size, offset);
+                result = bytes_read < 0 ? -errno : (int)bytes_read;
+                return false;
+            }
+        }
+        loop->in_flight.insert(this);
+        return true;
+    }
+
+    int await_resume() { return result; }
+};
+
+// io_uring 提交出错后这个线程改用同步 pread：先销毁 ring（内核取消尚未完成的请求），
+// 再把未完成的读请求同步重读一遍并恢复等待的协程，文件照常处理完，之后的读取在 await_ready 中直接完成
+static void fall_back_to_pread(EventLoop* loop) {
+    if (!loop->use_uring)
+        return;
+    uring_reader_destroy(&loop->ring);
+    loop->use_uring = false;
+    for (ReadAwaitable* read : loop->in_flight) {
+        ssize_t bytes_read = pread(read->fd, read->buffer, read->size, read->offset);
+        read->result = bytes_read < 0 ? -errno : (int)bytes_read;
+        loop->schedule(read->waiter);
+    }
+    loop->in_flight.clear();
+}
+
+static bool submit_failed(int ret) {
+    return ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY;
+}
+
+// 单消费者通道：push 不会阻塞（容量就是文件的缓冲块数），pop 在没有数据时挂起消费者
+struct BlockChannel {
+    EventLoop* loop;
+    std::deque<PipelineBlock*> items;
+    std::coroutine_handle<> waiter;
+
+    void push(PipelineBlock* block) {
+        items.push_back(block);
+        if (waiter) {
+            loop->schedule(waiter);
+            waiter = nullptr;
+        }
+    }
+
+    struct PopAwaitable {
+        BlockChannel* channel;
+        bool await_ready() { return !channel->items.empty(); }
+        void await_suspend(std::coroutine_handle<> handle) { channel->waiter = handle; }
+        PipelineBlock* await_resume() {
+            PipelineBlock* block = channel->items.front();
+            channel->items.pop_front();
+            return block;
+        }
+    };
+
+    PopAwaitable pop() { return PopAwaitable{this}; }
+};
+
+// 一个文件的流水线：channels[s] 把块交给第 s 个阶段，channels[num_stages] 把用完的块还给读取协程
+struct FileJob {
+    EventLoop* loop;
+    size_t file_index;
+    int fd;
+    uint64_t file_size;
+    bool ok;
+    int remaining_tasks;
+    char* pool;
+    PipelineBlock blocks[PIPELINE_BLOCKS_PER_FILE];
+    std::vector<BlockChannel> channels;
+    std::vector<void*> states;
+};
+
+static void start_next_file(EventLoop* loop);
+
+// 最后一个协程结束时收尾，并从共享队列领取下一个文件
+static void task_done(FileJob* job) {
+    if (--job->remaining_tasks > 0)
+        return;
+    const std::vector<PipelineStage*>& stages = *job->loop->ctx->stages;
+    for (size_t s = 0; s < stages.size(); s++)
+        stages[s]->end_file(stages[s], job->states[s], job->file_index, job->ok);
+    if (job->fd >= 0)
+        close(job->fd);
+    free(job->pool);
+
+    EventLoop* loop = job->loop;
+    delete job;
+    loop->active_files--;
+    start_next_file(loop);
+}
+
+// 读取协程：循环取空闲块、co_await 异步读、交给第一个阶段；读完后发送结束标记（NULL）
+static PipelineTask reader_task(FileJob* job) {
+    EventLoop* loop = job->loop;
+    BlockChannel* free_blocks = &job->channels.back();
+    uint64_t offset = 0;
+    while (job->ok && offset < job->file_size) {
+        PipelineBlock* block = co_await free_blocks->pop();
+        size_t to_read = job->file_size - offset < PIPELINE_BLOCK_SIZE ? (size_t)(job->file_size - offset)
+                                                                       : PIPELINE_BLOCK_SIZE;
+        int result = co_await ReadAwaitable{loop, job->fd, block->data, to_read, (off_t)offset, 0, nullptr};
+        if (result < 0) {
+            job->ok = false;
+            break;
+        }
+        // 文件在扫描期间被截断
+        if (result == 0)
+            break;
+        block->size = (size_t)result;
+        offset += result;
+        job->channels[0].push(block);
+    }
+    job->channels[0].push(nullptr);
+    task_done(job);
+}
+
+// 阶段协程：按顺序处理块，再交给下一个阶段（最后一个阶段把块还给读取协程）
+static PipelineTask stage_task(FileJob* job, size_t s) {
+    PipelineStage* stage = (*job->loop->ctx->stages)[s];
+    bool last = s + 1 == job->channels.size() - 1;
+    while (true) {
+        PipelineBlock* block = co_await job->channels[s].pop();
+        if (block == nullptr) {
+            if (!last)
+                job->channels[s + 1].push(nullptr);
+            break;
+        }
+        stage->process(stage, job->states[s], block->data, block->size);
+        job->channels[s + 1].push(block);
+    }
+    task_done(job);
+}
+
+static void start_file(EventLoop* loop, size_t file_index) {
+    const std::vector<PipelineStage*>& stages = *loop->ctx->stages;
+    FileJob* job = new FileJob();
+    job->loop = loop;
+    job->file_index = file_index;
+    job->fd = open((*loop->ctx->files)[file_index].c_str(), O_RDONLY);
+    job->file_size = 0;
+    job->ok = false;
+    job->pool = NULL;
+
+    struct stat st;
+    if (job->fd >= 0 && fstat(job->fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        job->file_size = st.st_size;
+        job->pool = alloc_io_buffer((size_t)PIPELINE_BLOCKS_PER_FILE * PIPELINE_BLOCK_SIZE);
+        job->ok = job->pool != NULL;
+    }
+    if (job->ok)
+        posix_fadvise(job->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    job->channels.resize(stages.size() + 1);
+    for (size_t c = 0; c < job->channels.size(); c++)
+        job->channels[c].loop = loop;
+    job->states.resize(stages.size());
+    for (size_t s = 0; s < stages.size(); s++)
+        job->states[s] = stages[s]->begin_file(stages[s], file_index, job->file_size);
+
+    if (job->ok) {
+        for (int b = 0; b < PIPELINE_BLOCKS_PER_FILE; b++) {
+            job->blocks[b].data = job->pool + (size_t)b * PIPELINE_BLOCK_SIZE;
+            job->blocks[b].size = 0;
+            job->channels.back().push(&job->blocks[b]);
+        }
+    }
+
+    // 读取协程和每个阶段各一个协程，全部结束后 task_done 收尾
+    loop->active_files++;
+    job->remaining_tasks = (int)stages.size() + 1;
+    loop->schedule(reader_task(job).handle);
+    for (size_t s = 0; s < stages.size(); s++)
+        loop->schedule(stage_task(job, s).handle);
+}
+
+static void start_next_file(EventLoop* loop) {
+    size_t file_index = loop->ctx->next_file.fetch_add(1);
+    if (file_index < loop->ctx->files->size())
+        start_file(loop, file_index);
+}
+
+static void run_event_loop(EventLoop* loop) {
+    for (int i = 0; i < loop->ctx->files_in_flight; i++)
+        start_next_file(loop);
+
+    while (loop->active_files > 0) {
+        while (!loop->ready.empty()) {
+            std::coroutine_handle<> handle = loop->ready.front();
+            loop->ready.pop_front();
+            handle.resume();
+            // 新填写的读请求马上提交，下一块的读取和后面协程的统计同时进行
+            if (loop->use_uring && loop->ring.sq_pending > 0 && submit_failed(uring_reader_submit(&loop->ring, 0)))
+                fall_back_to_pread(loop);
+        }
+        if (!loop->ready.empty())
+            continue;
+        // 没有可运行的协程也没有在途读请求，却还有文件没结束：协程之间互相等待，不会再有进展
+        if (loop->in_flight.empty())
+            break;
+
+        // 所有协程都在等 I/O：至少等一个完成
+        if (submit_failed(uring_reader_submit(&loop->ring, 1))) {
+            fall_back_to_pread(loop);
+            continue;
+        }
+        uint64_t user_data;
+        int res;
+        while (uring_reader_pop(&loop->ring, &user_data, &res)) {
+            ReadAwaitable* read = (ReadAwaitable*)user_data;
+            read->result = res;
+            loop->in_flight.erase(read);
+            loop->schedule(read->waiter);
+        }
+    }
+}
+
+static void* event_loop_thread(void* arg) {
+    EventLoop* loop = (EventLoop*)arg;
+    unsigned entries = (unsigned)loop->ctx->files_in_flight * 2;
+    loop->use_uring = uring_reader_init(&loop->ring, entries < 8 ? 8 : entries) == 0;
+    if (loop->use_uring)
+        loop->ctx->used_uring.store(true);
+
+    run_event_loop(loop);
+
+    if (loop->use_uring)
+        uring_reader_destroy(&loop->ring);
+    return NULL;
+}
+
+bool filelines_pipeline(const std::vector<std::string>& files, const std::vector<PipelineStage*>& stages,
+                        int num_threads, int files_in_flight) {
+    if (files.empty() || stages.empty())
+        return false;
+    if (num_threads <= 0)
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (files_in_flight <= 0)
+        files_in_flight = PIPELINE_FILES_IN_FLIGHT;
+    // 文件少时减少线程数，每个线程至少分到 files_in_flight 个文件
+    int max_threads = (int)((files.size() + files_in_flight - 1) / files_in_flight);
+    if (num_threads > max_threads)
+        num_threads = max_threads;
+
+    PipelineContext ctx;
+    ctx.files = &files;
+    ctx.stages = &stages;
+    ctx.next_file.store(0);
+    ctx.files_in_flight = files_in_flight;
+    ctx.used_uring.store(false);
+
+    std::vector<EventLoop> loops(num_threads);
+    std::vector<pthread_t> threads(num_threads);
+    for (int t = 0; t < num_threads; t++) {
+        loops[t].ctx = &ctx;
+        loops[t].use_uring = false;
+        loops[t].active_files = 0;
+    }
+    if (num_threads == 1) {
+        event_loop_thread(&loops[0]);
+    } else {
+        for (int t = 0; t < num_threads; t++)
+            pthread_create(&threads[t], NULL, event_loop_thread, &loops[t]);
+        for (int t = 0; t < num_threads; t++)
+            pthread_join(threads[t], NULL);
+    }
+    return ctx.used_uring.load();
+}
+
+// ---------------- 内置阶段 ----------------
+
+struct HistogramState {
+    LineHistogram* hist;
+    uint64_t cur_len;
+};
+
+static void* histogram_begin(PipelineStage* stage, size_t file_index, uint64_t file_size) {
+    BatchFileResult* result = &(*((HistogramStage*)stage)->results)[file_index];
+    result->file_size = file_size;
+    line_histogram_init(&result->hist);
+    HistogramState* state = new HistogramState();
+    state->hist = &result->hist;
+    state->cur_len = 0;
+    return state;
+}
+
+static void histogram_process([[maybe_unused]] PipelineStage* stage, void* state, const char* data, size_t size) {
+    HistogramState* hist_state = (HistogramState*)state;
+    process_block_simd_wide(data, size, hist_state->hist, &hist_state->cur_len);
+}
+
+static void histogram_end(PipelineStage* stage, void* state, size_t file_index, bool ok) {
+    BatchFileResult* result = &(*((HistogramStage*)stage)->results)[file_index];
+    result->ok = ok;
+    // 与 filelines_batch 一致：失败的文件不保留部分统计
+    if (!ok) {
+        result->file_size = 0;
+        line_histogram_init(&result->hist);
+    }
+    delete (HistogramState*)state;
+}
+
+void histogram_stage_init(HistogramStage* stage, std::vector<BatchFileResult>* results) {
+    stage->base.begin_file = histogram_begin;
+    stage->base.process = histogram_process;
+    stage->base.end_file = histogram_end;
+    stage->results = results;
+}
+
+// CRC32C（Castagnoli）软件实现的查找表，首次使用时生成
+static uint32_t crc32c_table[256];
+static pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init_table() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++)
+            crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        crc32c_table[i] = crc;
+    }
+}
+
+static uint32_t crc32c_soft(uint32_t crc, const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        crc = crc32c_table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(uint32_t crc, const char* data, size_t size) {
+    uint64_t crc64 = crc;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    uint32_t crc32 = (uint32_t)crc64;
+    for (; i < size; i++)
+        crc32 = _mm_crc32_u8(crc32, (unsigned char)data[i]);
+    return crc32;
+}
+
+static void* checksum_begin([[maybe_unused]] PipelineStage* stage, [[maybe_unused]] size_t file_index,
+                            [[maybe_unused]] uint64_t file_size) {
+    pthread_once(&crc32c_table_once, crc32c_init_table);
+    return new uint32_t(0xFFFFFFFF);
+}
+
+static void checksum_process([[maybe_unused]] PipelineStage* stage, void* state, const char* data, size_t size) {
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    uint32_t* crc = (uint32_t*)state;
+    *crc = has_sse42 ? crc32c_sse42(*crc, data, size) : crc32c_soft(*crc, data, size);
+}
+
+static void checksum_end(PipelineStage* stage, void* state, size_t file_index, bool ok) {
+    uint32_t* crc = (uint32_t*)state;
+    (*((ChecksumStage*)stage)->crcs)[file_index] = ok ? *crc ^ 0xFFFFFFFF : 0;
+    delete crc;
+}
+
+void checksum_stage_init(ChecksumStage* stage, std::vector<uint32_t>* crcs) {
+    stage->base.begin_file = checksum_begin;
+    stage->base.process = checksum_process;
+    stage->base.end_file = checksum_end;
+    stage->crcs = crcs;
+}
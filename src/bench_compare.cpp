@@ -0,0 +1,227 @@
+/*
+ * 基准结果对比工具
+ * 从结果库（bench_harness 的 --store 选项追加的记录）中取出两个版本在同一台机器上的结果，
+ * 对每个测试版本的吞吐量做 Welch t 检验，下降超过阈值且统计显著时标记为性能回退
+ * 有回退时返回 1，可以放在部署新构建前的检查里
+ */
+
+#include "bench_store.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+using namespace std;
+
+// 同一台机器、同一测试程序、同一测试版本在一个版本下的所有样本（多次追加的记录合并）
+struct VariantSamples {
+    string unit;
+    vector<double> throughputs; // 每次运行的吞吐量（工作量 / 秒数）
+};
+
+// (指纹, benchmark, 测试版本名)
+typedef map<string, map<string, map<string, VariantSamples>>> SampleTable;
+
+static void mean_and_variance(const vector<double>& values, double* mean, double* variance) {
+    double sum = 0;
+    for (double v : values)
+        sum += v;
+    *mean = sum / values.size();
+    double sq = 0;
+    for (double v : values)
+        sq += (v - *mean) * (v - *mean);
+    *variance = values.size() > 1 ? sq / (values.size() - 1) : 0;
+}
+
+static void collect(const vector<BenchRecord>& records, const string& revision, const string& host,
+                    const char* benchmark, SampleTable* table) {
+    for (const BenchRecord& r : records) {
+        if (r.revision != revision || (!host.empty() && r.fingerprint != host))
+            continue;
+        if (benchmark && r.benchmark != benchmark)
+            continue;
+        VariantSamples& samples = (*table)[r.fingerprint][r.benchmark][r.variant];
+        samples.unit = r.unit;
+        for (double seconds : r.samples)
+            samples.throughputs.push_back(r.work / seconds);
+    }
+}
+
+// 列出结果库中各机器上的版本
+static void list_revisions(const vector<BenchRecord>& records) {
+    map<string, string> cpu_of;
+    map<string, map<string, pair<int, long long>>> revisions; // 指纹 -> 版本 -> (记录数, 最近时间)
+    for (const BenchRecord& r : records) {
+        cpu_of[r.fingerprint] = r.cpu_model;
+        pair<int, long long>& entry = revisions[r.fingerprint][r.revision];
+        entry.first++;
+        entry.second = max(entry.second, r.timestamp);
+    }
+    for (const auto& host : revisions) {
+        cout << "机器 " << host.first << " (" << cpu_of[host.first] << ")" << endl;
+        for (const auto& rev : host.second) {
+            time_t t = (time_t)rev.second.second;
+            char when[32];
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&t));
+            cout << "  " << left << setw(32) << rev.first << setw(8) << rev.second.first << when << endl;
+        }
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "用法: %s [选项] <基准版本> <新版本>\n", prog);
+    fprintf(stderr, "      %s [--store FILE] --list\n", prog);
+    fprintf(stderr, "选项:\n");
+    fprintf(stderr, "  --store FILE      结果库（默认 %s）\n", BENCH_STORE_DEFAULT);
+    fprintf(stderr, "  --threshold P     吞吐量下降超过 P%% 且显著时算回退（默认 2）\n");
+    fprintf(stderr, "  --benchmark NAME  只对比某个测试程序（如 mt_perf_test、matrix_multiply）\n");
+    fprintf(stderr, "  --host FP         对比指定指纹的机器（默认本机），all 表示所有机器\n");
+    fprintf(stderr, "  --list            列出结果库中各机器上的版本\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* store = BENCH_STORE_DEFAULT;
+    const char* benchmark = NULL;
+    const char* host_option = NULL;
+    double threshold = 0.02;
+    bool list = false;
+    vector<string> revisions;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--store") == 0 && has_value) {
+            store = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && has_value) {
+            threshold = atof(argv[++i]) / 100.0;
+        } else if (strcmp(argv[i], "--benchmark") == 0 && has_value) {
+            benchmark = argv[++i];
+        } else if (strcmp(argv[i], "--host") == 0 && has_value) {
+            host_option = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            revisions.push_back(argv[i]);
+        }
+    }
+    if ((!list && revisions.size() != 2) || threshold < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    vector<BenchRecord> records;
+    int skipped = 0;
+    if (!bench_store_load(store, &records, &skipped)) {
+        fprintf(stderr, "错误: 无法打开结果库 '%s'\n", store);
+        return 2;
+    }
+    if (skipped > 0)
+        fprintf(stderr, "警告: 跳过 %d 行格式不正确的记录\n", skipped);
+
+    if (list) {
+        list_revisions(records);
+        return 0;
+    }
+
+    // 默认只比较本机的结果，不同机器的吞吐量没有可比性
+    string host;
+    if (!host_option) {
+        BenchHost self;
+        bench_host_detect(&self);
+        host = self.fingerprint;
+    } else if (strcmp(host_option, "all") != 0) {
+        host = host_option;
+    }
+
+    SampleTable base, next;
+    collect(records, revisions[0], host, benchmark, &base);
+    collect(records, revisions[1], host, benchmark, &next);
+    if (base.empty() || next.empty()) {
+        fprintf(stderr, "错误: 结果库中没有%s版本 '%s' 的结果%s\n", host_option ? "" : "本机上",
+                (base.empty() ? revisions[0] : revisions[1]).c_str(), host_option ? "" : "（可用 --list 查看）");
+        return 2;
+    }
+
+    cout << "对比 " << revisions[0] << " → " << revisions[1] << "（吞吐量均值，Welch t 检验 95%，阈值 " << fixed
+         << setprecision(1) << threshold * 100 << "%）" << endl;
+
+    int regressions = 0, improvements = 0, compared = 0;
+    for (const auto& host_entry : base) {
+        auto next_host = next.find(host_entry.first);
+        if (next_host == next.end())
+            continue;
+        for (const auto& bench_entry : host_entry.second) {
+            auto next_bench = next_host->second.find(bench_entry.first);
+            if (next_bench == next_host->second.end())
+                continue;
+
+            cout << "\n[" << bench_entry.first << "] 机器 " << host_entry.first << endl;
+            cout << left << setw(40) << "版本" << setw(22) << revisions[0] << setw(22) << revisions[1] << setw(10)
+                 << "变化" << "结论" << endl;
+            cout << string(106, '-') << endl;
+
+            for (const auto& variant : bench_entry.second) {
+                auto found = next_bench->second.find(variant.first);
+                if (found == next_bench->second.end()) {
+                    cout << left << setw(40) << variant.first << "仅在 " << revisions[0] << " 中" << endl;
+                    continue;
+                }
+                const VariantSamples& a = variant.second;
+                const VariantSamples& b = found->second;
+                double mean_a, var_a, mean_b, var_b;
+                mean_and_variance(a.throughputs, &mean_a, &var_a);
+                mean_and_variance(b.throughputs, &mean_b, &var_b);
+                double change = (mean_b - mean_a) / mean_a;
+
+                // Welch t 检验：两组方差不假定相等，自由度用 Welch–Satterthwaite 近似
+                double se_a = var_a / a.throughputs.size(), se_b = var_b / b.throughputs.size();
+                double se = sqrt(se_a + se_b);
+                bool significant;
+                if (a.throughputs.size() < 2 || b.throughputs.size() < 2) {
+                    significant = false;
+                } else if (se == 0) {
+                    significant = mean_a != mean_b;
+                } else {
+                    double df = (se_a + se_b) * (se_a + se_b) /
+                                (se_a * se_a / (a.throughputs.size() - 1) + se_b * se_b / (b.throughputs.size() - 1));
+                    significant = fabs(mean_b - mean_a) / se > bench_t_critical((int)df);
+                }
+
+                const char* verdict = "无显著变化";
+                if (a.throughputs.size() < 2 || b.throughputs.size() < 2) {
+                    verdict = "样本不足";
+                } else if (significant && change < -threshold) {
+                    verdict = "回退 ✗";
+                    regressions++;
+                } else if (significant && change > threshold) {
+                    verdict = "提升";
+                    improvements++;
+                }
+                compared++;
+
+                char col_a[64], col_b[64], col_change[32];
+                snprintf(col_a, sizeof(col_a), "%.2f %s (n=%zu)", mean_a, a.unit.c_str(), a.throughputs.size());
+                snprintf(col_b, sizeof(col_b), "%.2f (n=%zu)", mean_b, b.throughputs.size());
+                snprintf(col_change, sizeof(col_change), "%+.1f%%", change * 100);
+                cout << left << setw(40) << variant.first << setw(22) << col_a << setw(22) << col_b << setw(10)
+                     << col_change << verdict << endl;
+            }
+            for (const auto& variant : next_bench->second) {
+                if (bench_entry.second.find(variant.first) == bench_entry.second.end())
+                    cout << left << setw(40) << variant.first << "仅在 " << revisions[1] << " 中" << endl;
+            }
+        }
+    }
+
+    cout << "\n共对比 " << compared << " 项: " << regressions << " 项回退, " << improvements << " 项提升" << endl;
+    return regressions > 0 ? 1 : 0;
+}
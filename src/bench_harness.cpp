@@ -0,0 +1,405 @@
+#include "bench_harness.h"
+
+#include "bench_store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+
+// JSON/CSV 中的计数器字段名，顺序与 PerfEvent 一致
+static const char* const counter_keys[PERF_NUM_EVENTS] = {
+    "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses",
+};
+
+void bench_config_init(BenchConfig* config) {
+    config->warmups = BENCH_DEFAULT_WARMUPS;
+    config->min_runs = BENCH_DEFAULT_MIN_RUNS;
+    config->max_runs = BENCH_DEFAULT_MAX_RUNS;
+    config->target_ci = BENCH_DEFAULT_TARGET_CI;
+    config->max_seconds = BENCH_DEFAULT_MAX_SECONDS;
+    config->json_path = NULL;
+    config->csv_path = NULL;
+    config->store_path = NULL;
+    config->revision = NULL;
+}
+
+// 解析非负整数、正数参数，失败返回 false
+static bool parse_int(const char* s, int* value) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (*s == '\0' || *end != '\0' || v < 0 || v > 1000000)
+        return false;
+    *value = (int)v;
+    return true;
+}
+
+static bool parse_double(const char* s, double* value) {
+    char* end;
+    double v = strtod(s, &end);
+    if (*s == '\0' || *end != '\0' || !(v > 0))
+        return false;
+    *value = v;
+    return true;
+}
+
+int bench_parse_option(BenchConfig* config, int argc, char** argv, int i) {
+    const char* opt = argv[i];
+    static const char* const with_value[] = {
+        "--runs", "--min-runs", "--max-runs", "--warmup", "--target-ci",
+        "--max-time", "--json", "--csv", "--store", "--revision",
+    };
+    bool known = false;
+    for (const char* name : with_value)
+        known = known || strcmp(opt, name) == 0;
+    if (!known)
+        return 0;
+    if (i + 1 >= argc) {
+        fprintf(stderr, "错误: %s 缺少参数\n", opt);
+        return -1;
+    }
+
+    const char* value = argv[i + 1];
+    bool ok = true;
+    int n = 0;
+    double d = 0;
+    if (strcmp(opt, "--runs") == 0) {
+        ok = parse_int(value, &n) && n > 0;
+        config->min_runs = config->max_runs = n;
+    } else if (strcmp(opt, "--min-runs") == 0) {
+        ok = parse_int(value, &n) && n > 0;
+        config->min_runs = n;
+        config->max_runs = max(config->max_runs, n);
+    } else if (strcmp(opt, "--max-runs") == 0) {
+        ok = parse_int(value, &n) && n > 0;
+        config->max_runs = n;
+        config->min_runs = min(config->min_runs, n);
+    } else if (strcmp(opt, "--warmup") == 0) {
+        ok = parse_int(value, &config->warmups);
+    } else if (strcmp(opt, "--target-ci") == 0) {
+        ok = parse_double(value, &d);
+        config->target_ci = d / 100.0;
+    } else if (strcmp(opt, "--max-time") == 0) {
+        ok = parse_double(value, &config->max_seconds);
+    } else if (strcmp(opt, "--json") == 0) {
+        config->json_path = value;
+    } else if (strcmp(opt, "--csv") == 0) {
+        config->csv_path = value;
+    } else if (strcmp(opt, "--store") == 0) {
+        config->store_path = value;
+    } else {
+        config->revision = value;
+    }
+    if (!ok) {
+        fprintf(stderr, "错误: %s 的参数无效: %s\n", opt, value);
+        return -1;
+    }
+    return 2;
+}
+
+const char* bench_usage() {
+    return "  --runs N        每个版本固定运行 N 次（默认自适应 3~15 次）\n"
+           "  --min-runs N    最少运行次数\n"
+           "  --max-runs N    最多运行次数\n"
+           "  --warmup N      预热次数，不计入统计（默认 1）\n"
+           "  --target-ci P   95% 置信区间半宽达到均值的 P% 时停止（默认 2）\n"
+           "  --max-time S    单个版本计时运行的总时长上限，秒（默认 20）\n"
+           "  --json FILE     结果写入 JSON（含每次运行的样本和硬件计数器）\n"
+           "  --csv FILE      结果写入 CSV\n"
+           "  --store FILE    结果追加到结果库（用 bench_compare 对比两个版本）\n"
+           "  --revision REV  结果库中记录的版本（默认为编译时的 git 版本或环境变量 BENCH_REVISION）\n";
+}
+
+double bench_t_critical(int df) {
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+        2.120,  2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (df < 1)
+        return INFINITY;
+    if (df <= 30)
+        return table[df - 1];
+    if (df <= 60)
+        return 2.000;
+    if (df <= 120)
+        return 1.980;
+    return 1.960;
+}
+
+void bench_compute_stats(BenchResult* result) {
+    const vector<double>& s = result->samples;
+    int n = s.size();
+    result->mean = result->median = result->min = result->max = result->stddev = 0;
+    result->ci_low = result->ci_high = 0;
+    result->throughput = 0;
+    if (n == 0)
+        return;
+
+    vector<double> sorted(s);
+    sort(sorted.begin(), sorted.end());
+    result->min = sorted[0];
+    result->max = sorted[n - 1];
+    result->median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+    double sum = 0;
+    for (double t : s)
+        sum += t;
+    result->mean = sum / n;
+
+    // 样本标准差（n - 1）
+    double sq = 0;
+    for (double t : s)
+        sq += (t - result->mean) * (t - result->mean);
+    result->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+
+    // 只有一个样本时区间不确定，记为 [mean, mean]
+    double half = n > 1 ? bench_t_critical(n - 1) * result->stddev / sqrt((double)n) : 0;
+    result->ci_low = result->mean - half;
+    result->ci_high = result->mean + half;
+
+    if (result->median > 0)
+        result->throughput = result->work / result->median;
+}
+
+// 运行一次：setup 不计时；计数器在 run 之前打开，统计 run 创建的工作线程
+static double run_once(BenchCase* bc, PerfSample* perf) {
+    if (bc->setup)
+        bc->setup(bc);
+
+    PerfCounters counters;
+    perf_counters_open(&counters);
+    perf_counters_start(&counters);
+    auto start = chrono::high_resolution_clock::now();
+    bc->run(bc);
+    auto end = chrono::high_resolution_clock::now();
+    perf_counters_stop(&counters, perf);
+    perf_counters_close(&counters);
+
+    return chrono::duration<double>(end - start).count();
+}
+
+void bench_run(BenchCase* bc, const BenchConfig* config, BenchResult* result) {
+    result->name = bc->name;
+    result->unit = bc->unit ? bc->unit : "";
+    result->work = bc->work;
+    result->samples.clear();
+    result->warmups = config->warmups;
+    result->stable = true;
+    perf_sample_clear(&result->perf);
+
+    cout << "  运行 " << bc->name << "..." << flush;
+
+    PerfSample perf;
+    for (int i = 0; i < config->warmups; i++)
+        run_once(bc, &perf);
+
+    vector<PerfSample> perfs;
+    double elapsed = 0;
+    for (int i = 0; i < config->max_runs; i++) {
+        double seconds = run_once(bc, &perf);
+        if (i == 0)
+            result->digest = bc->digest;
+        else if (bc->digest != result->digest)
+            result->stable = false;
+        result->samples.push_back(seconds);
+        perfs.push_back(perf);
+        elapsed += seconds;
+
+        if ((int)result->samples.size() < config->min_runs)
+            continue;
+        bench_compute_stats(result);
+        double half = (result->ci_high - result->ci_low) / 2;
+        if (half <= result->mean * config->target_ci || elapsed >= config->max_seconds)
+            break;
+    }
+    bench_compute_stats(result);
+    for (const PerfSample& p : perfs)
+        perf_sample_accumulate(&result->perf, &p, 1.0 / perfs.size());
+
+    cout << " 完成 (" << result->samples.size() << " 次, 中位数 " << fixed << setprecision(4) << result->median
+         << "s, ±" << setprecision(1) << (result->mean > 0 ? (result->ci_high - result->mean) / result->mean * 100 : 0)
+         << "%)" << endl;
+}
+
+void bench_run_all(const vector<BenchCase*>& cases, const BenchConfig* config, vector<BenchResult>* results) {
+    results->resize(cases.size());
+    for (size_t c = 0; c < cases.size(); c++)
+        bench_run(cases[c], config, &(*results)[c]);
+}
+
+// 按终端显示宽度补齐到 width 列（UTF-8 中文占两列），超出时至少留一个空格
+static string pad_cell(const string& s, int width) {
+    int columns = 0;
+    for (unsigned char ch : s) {
+        if (ch < 0x80)
+            columns += 1;
+        else if (ch >= 0xE0)
+            columns += 2;
+        else if (ch >= 0xC0)
+            columns += 1;
+    }
+    return s + string(columns < width ? width - columns : 1, ' ');
+}
+
+void bench_print_results(const vector<BenchResult>& results, int baseline) {
+    if (results.empty())
+        return;
+    cout << pad_cell("版本", 34) << pad_cell("次数", 6) << pad_cell("中位数(秒)", 12) << pad_cell("最快(秒)", 12)
+         << pad_cell("标准差(秒)", 12) << pad_cell("95%置信区间(秒)", 24)
+         << pad_cell("吞吐量(" + results[0].unit + ")", 16) << "加速比" << endl;
+    cout << string(122, '-') << endl;
+
+    for (const BenchResult& r : results) {
+        double speedup = r.median > 0 ? results[baseline].median / r.median : 0;
+        char ci[64];
+        snprintf(ci, sizeof(ci), "[%.4f, %.4f]", r.ci_low, r.ci_high);
+        cout << pad_cell(r.name, 34) << left << setw(6) << r.samples.size() << fixed << setprecision(4) << setw(12)
+             << r.median << setw(12) << r.min << setw(12) << r.stddev << setw(24) << ci << setprecision(2) << setw(16)
+             << r.throughput << speedup << "x" << (r.stable ? "" : "  (各次结果不一致!)") << endl;
+    }
+    cout << string(122, '-') << endl;
+
+    char perf_line[256];
+    cout << "硬件计数器（平均）:" << endl;
+    for (const BenchResult& r : results) {
+        perf_sample_format(&r.perf, perf_line, sizeof(perf_line));
+        cout << "  " << pad_cell(r.name, 34) << perf_line << endl;
+    }
+}
+
+// 输出 JSON 字符串（加引号并转义）
+static void json_string(FILE* fp, const string& s) {
+    fputc('"', fp);
+    for (unsigned char ch : s) {
+        if (ch == '"' || ch == '\\')
+            fprintf(fp, "\\%c", ch);
+        else if (ch < 0x20)
+            fprintf(fp, "\\u%04x", ch);
+        else
+            fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+bool bench_write_json(const char* path, const char* benchmark, const BenchConfig* config,
+                      const vector<BenchResult>& results) {
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "{\n  \"benchmark\": ");
+    json_string(fp, benchmark);
+    fprintf(fp, ",\n  \"timestamp\": %lld,\n", (long long)time(NULL));
+    fprintf(fp,
+            "  \"config\": {\"warmups\": %d, \"min_runs\": %d, \"max_runs\": %d, \"target_ci\": %g, "
+            "\"max_seconds\": %g},\n",
+            config->warmups, config->min_runs, config->max_runs, config->target_ci, config->max_seconds);
+    fprintf(fp, "  \"results\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(fp, "%s\n    {\"name\": ", i > 0 ? "," : "");
+        json_string(fp, r.name);
+        fprintf(fp, ", \"unit\": ");
+        json_string(fp, r.unit);
+        fprintf(fp,
+                ", \"work\": %.17g, \"runs\": %zu, \"warmups\": %d, \"median\": %.9g, \"mean\": %.9g, \"min\": %.9g, "
+                "\"max\": %.9g, \"stddev\": %.9g, \"ci95_low\": %.9g, \"ci95_high\": %.9g, \"throughput\": %.9g, "
+                "\"digest\": %llu, \"stable\": %s,\n     \"samples\": [",
+                r.work, r.samples.size(), r.warmups, r.median, r.mean, r.min, r.max, r.stddev, r.ci_low, r.ci_high,
+                r.throughput, (unsigned long long)r.digest, r.stable ? "true" : "false");
+        for (size_t s = 0; s < r.samples.size(); s++)
+            fprintf(fp, "%s%.9g", s > 0 ? ", " : "", r.samples[s]);
+        fprintf(fp, "],\n     \"counters\": {");
+        for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            fprintf(fp, "%s\"%s\": ", e > 0 ? ", " : "", counter_keys[e]);
+            if (r.perf.valid[e])
+                fprintf(fp, "%.0f", r.perf.value[e]);
+            else
+                fprintf(fp, "null");
+        }
+        fprintf(fp, "}}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+// 输出 CSV 字段（含逗号、引号或换行时加引号）
+static void csv_field(FILE* fp, const string& s) {
+    if (s.find_first_of(",\"\n\r") == string::npos) {
+        fputs(s.c_str(), fp);
+        return;
+    }
+    fputc('"', fp);
+    for (char ch : s) {
+        if (ch == '"')
+            fputc('"', fp);
+        fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+bool bench_write_csv(const char* path, const char* benchmark, const vector<BenchResult>& results) {
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "benchmark,name,unit,runs,median_s,mean_s,min_s,max_s,stddev_s,ci95_low_s,ci95_high_s,throughput");
+    for (int e = 0; e < PERF_NUM_EVENTS; e++)
+        fprintf(fp, ",%s", counter_keys[e]);
+    fprintf(fp, "\n");
+    for (const BenchResult& r : results) {
+        csv_field(fp, benchmark);
+        fputc(',', fp);
+        csv_field(fp, r.name);
+        fputc(',', fp);
+        csv_field(fp, r.unit);
+        fprintf(fp, ",%zu,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g", r.samples.size(), r.median, r.mean, r.min, r.max,
+                r.stddev, r.ci_low, r.ci_high, r.throughput);
+        // 不可用的计数器留空
+        for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            if (r.perf.valid[e])
+                fprintf(fp, ",%.0f", r.perf.value[e]);
+            else
+                fprintf(fp, ",");
+        }
+        fprintf(fp, "\n");
+    }
+    return fclose(fp) == 0;
+}
+
+bool bench_emit(const BenchConfig* config, const char* benchmark, const vector<BenchResult>& results) {
+    bool ok = true;
+    if (config->json_path) {
+        if (bench_write_json(config->json_path, benchmark, config, results)) {
+            cout << "JSON 结果: " << config->json_path << endl;
+        } else {
+            fprintf(stderr, "错误: 无法写入 '%s'\n", config->json_path);
+            ok = false;
+        }
+    }
+    if (config->csv_path) {
+        if (bench_write_csv(config->csv_path, benchmark, results)) {
+            cout << "CSV 结果: " << config->csv_path << endl;
+        } else {
+            fprintf(stderr, "错误: 无法写入 '%s'\n", config->csv_path);
+            ok = false;
+        }
+    }
+    if (config->store_path) {
+        const char* revision = config->revision ? config->revision : bench_build_revision();
+        if (bench_store_append(config->store_path, benchmark, results, revision)) {
+            cout << "已追加到结果库: " << config->store_path << " (版本 " << revision << ")" << endl;
+        } else {
+            fprintf(stderr, "错误: 无法写入结果库 '%s'\n", config->store_path);
+            ok = false;
+        }
+    }
+    return ok;
+}
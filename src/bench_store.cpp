@@ -0,0 +1,199 @@
+#include "bench_store.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_GIT_REVISION
+#define BENCH_GIT_REVISION "unknown"
+#endif
+
+using namespace std;
+
+// 64 位 FNV-1a
+static uint64_t fnv1a(const string& s) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char ch : s) {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static string read_cpu_model() {
+    FILE* fp = fopen("/proc/cpuinfo", "r");
+    if (!fp)
+        return "unknown";
+    char line[512];
+    string model = "unknown";
+    while (fgets(line, sizeof(line), fp)) {
+        // x86 为 "model name"，部分 ARM 内核只有 "CPU part"，这里只取 model name
+        if (strncmp(line, "model name", 10) != 0)
+            continue;
+        char* colon = strchr(line, ':');
+        if (!colon)
+            continue;
+        char* value = colon + 1;
+        while (*value == ' ' || *value == '\t')
+            value++;
+        value[strcspn(value, "\r\n")] = '\0';
+        model = value;
+        break;
+    }
+    fclose(fp);
+    return model;
+}
+
+void bench_host_detect(BenchHost* host) {
+    char name[256] = "unknown";
+    gethostname(name, sizeof(name) - 1);
+    host->hostname = name;
+    host->cpu_model = read_cpu_model();
+
+    struct utsname uts;
+    string release = uname(&uts) == 0 ? uts.release : "";
+    long long mem_mb = (long long)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / (1 << 20);
+    string id = host->hostname + "|" + host->cpu_model + "|" + to_string(sysconf(_SC_NPROCESSORS_ONLN)) + "|" +
+                to_string(mem_mb) + "|" + release;
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)fnv1a(id));
+    host->fingerprint = hex;
+}
+
+const char* bench_build_revision() {
+    const char* env = getenv("BENCH_REVISION");
+    if (env && *env)
+        return env;
+    return BENCH_GIT_REVISION;
+}
+
+// 字段中的制表符和换行替换为空格，保证一行一条记录
+static string clean_field(const string& s) {
+    string out(s);
+    for (char& ch : out) {
+        if (ch == '\t' || ch == '\n' || ch == '\r')
+            ch = ' ';
+    }
+    return out.empty() ? "-" : out;
+}
+
+bool bench_store_append(const char* path, const char* benchmark, const vector<BenchResult>& results,
+                        const char* revision) {
+    if (!revision)
+        revision = bench_build_revision();
+    BenchHost host;
+    bench_host_detect(&host);
+
+#ifdef __VERSION__
+    const char* compiler = __VERSION__;
+#else
+    const char* compiler = "unknown";
+#endif
+
+    // 先拼好整段再一次写入；O_APPEND 加文件锁，几个测试同时追加时记录不会交错
+    string text;
+    long long now = (long long)time(NULL);
+    for (const BenchResult& r : results) {
+        if (r.samples.empty() || r.work <= 0)
+            continue;
+        char number[64];
+        text += to_string(now) + "\t" + host.fingerprint + "\t" + clean_field(host.cpu_model) + "\t" +
+                clean_field(revision) + "\t" + clean_field(compiler) + "\t" + clean_field(benchmark) + "\t" +
+                clean_field(r.name) + "\t" + clean_field(r.unit) + "\t";
+        snprintf(number, sizeof(number), "%.17g", r.work);
+        text += number;
+        text += "\t";
+        for (size_t s = 0; s < r.samples.size(); s++) {
+            snprintf(number, sizeof(number), "%s%.9g", s > 0 ? "," : "", r.samples[s]);
+            text += number;
+        }
+        text += "\n";
+    }
+
+    int handle = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (handle < 0)
+        return false;
+    flock(handle, LOCK_EX);
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(handle, text.data() + written, text.size() - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+    flock(handle, LOCK_UN);
+    close(handle);
+    return written == text.size();
+}
+
+// 按分隔符切分，保留空字段
+static vector<string> split(const string& s, char sep) {
+    vector<string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t pos = s.find(sep, start);
+        if (pos == string::npos) {
+            parts.push_back(s.substr(start));
+            return parts;
+        }
+        parts.push_back(s.substr(start, pos - start));
+        start = pos + 1;
+    }
+}
+
+bool bench_store_load(const char* path, vector<BenchRecord>* records, int* skipped) {
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return false;
+
+    int bad = 0;
+    char* buffer = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&buffer, &capacity, fp)) >= 0) {
+        string line(buffer, length);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        vector<string> fields = split(line, '\t');
+        if (fields.size() != 10) {
+            bad++;
+            continue;
+        }
+        BenchRecord record;
+        char* end;
+        record.timestamp = strtoll(fields[0].c_str(), &end, 10);
+        record.fingerprint = fields[1];
+        record.cpu_model = fields[2];
+        record.revision = fields[3];
+        record.compiler = fields[4];
+        record.benchmark = fields[5];
+        record.variant = fields[6];
+        record.unit = fields[7];
+        record.work = strtod(fields[8].c_str(), &end);
+        bool ok = *end == '\0' && record.work > 0;
+        for (const string& sample : split(fields[9], ',')) {
+            double seconds = strtod(sample.c_str(), &end);
+            ok = ok && *end == '\0' && seconds > 0;
+            record.samples.push_back(seconds);
+        }
+        if (!ok) {
+            bad++;
+            continue;
+        }
+        records->push_back(record);
+    }
+    free(buffer);
+    fclose(fp);
+    if (skipped)
+        *skipped = bad;
+    return true;
+}
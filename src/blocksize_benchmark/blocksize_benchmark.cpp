@@ -1,10 +1,12 @@
 /*
  * 块大小性能测试程序
  * 测试不同块大小对文件读取性能的影响
+ * 每行结果下面输出该次运行的硬件计数器（不可用时显示 n/a）
  */
 
 #include "filelines_blocksize.h"
 #include "find_most_freq.h"
+#include "perf_counters.h"
 
 #include <chrono>
 #include <iomanip>
@@ -46,12 +48,12 @@ void print_header() {
 }
 
 void print_result_header() {
-    cout << left << setw(15) << "块大小" << setw(18) << "执行时间(秒)" << setw(20) << "吞吐量(MB/s)" << setw(20)
+    cout << left << setw(23) << "块大小" << setw(18) << "执行时间(秒)" << setw(20) << "吞吐量(MB/s)" << setw(20)
          << "总行数" << setw(20) << "最频繁长度" << setw(20) << "出现次数" << endl;
-    cout << string(85, '-') << endl;
+    cout << string(93, '-') << endl;
 }
 
-void test_block_size(char* filepath, size_t block_size, const char* size_name) {
+void test_block_size(char* filepath, size_t block_size, const char* size_name, bool direct_io = false) {
     uint32_t line_num[MAX_LEN];
     uint32_t total_line_num = 0;
 
@@ -59,15 +61,27 @@ void test_block_size(char* filepath, size_t block_size, const char* size_name) {
     for (int i = 0; i < MAX_LEN; i++)
         line_num[i] = 0;
 
+    PerfCounters counters;
+    perf_counters_open(&counters);
+
     // 计时开始
+    perf_counters_start(&counters);
     auto start = chrono::high_resolution_clock::now();
 
     // 执行文件分析
-    filelines_with_blocksize(filepath, &total_line_num, line_num, block_size);
+    bool used_direct = filelines_with_blocksize(filepath, &total_line_num, line_num, block_size, direct_io);
 
     // 计时结束
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double> duration = end - start;
+    PerfSample perf;
+    perf_counters_stop(&counters, &perf);
+    perf_counters_close(&counters);
+
+    // O_DIRECT 模式在块大小后面加标记；块大小不对齐或文件系统不支持而退回页缓存时标为 buffered
+    string label = string(size_name);
+    if (direct_io)
+        label += used_direct ? " (O_DIRECT)" : " (buffered)";
 
     // 查找最频繁的行长度
     uint32_t most_freq_len, most_freq_len_linenum;
@@ -83,24 +97,30 @@ void test_block_size(char* filepath, size_t block_size, const char* size_name) {
         double throughput = (file_size / (1024.0 * 1024.0)) / duration.count();
 
         // 输出结果
-        cout << left << setw(12) << size_name << fixed << setprecision(4) << setw(18) << duration.count()
+        cout << left << setw(20) << label << fixed << setprecision(4) << setw(18) << duration.count()
              << setprecision(2) << setw(15) << throughput << setw(12) << total_line_num << setw(15) << most_freq_len
              << most_freq_len_linenum << endl;
     } else {
         // 如果无法获取文件大小，只输出时间和统计信息
-        cout << left << setw(12) << size_name << fixed << setprecision(4) << setw(18) << duration.count() << setw(15)
+        cout << left << setw(20) << label << fixed << setprecision(4) << setw(18) << duration.count() << setw(15)
              << "N/A" << setw(12) << total_line_num << setw(15) << most_freq_len << most_freq_len_linenum << endl;
     }
+
+    char perf_line[256];
+    perf_sample_format(&perf, perf_line, sizeof(perf_line));
+    cout << "  " << perf_line << endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "用法: %s <filepath>\n", argv[0]);
+    // --direct: 每个块大小额外用 O_DIRECT 测一次，与页缓存读取对比
+    bool compare_direct = argc == 3 && strcmp(argv[1], "--direct") == 0;
+    if (argc != 2 && !compare_direct) {
+        fprintf(stderr, "用法: %s [--direct] <filepath>\n", argv[0]);
         fprintf(stderr, "示例: %s test_2gb.txt\n", argv[0]);
         return 1;
     }
 
-    char* filepath = argv[1];
+    char* filepath = argv[argc - 1];
 
     // 检查文件是否存在
     FILE* fp = fopen(filepath, "rb");
@@ -119,6 +139,13 @@ int main(int argc, char* argv[]) {
     cout << "文件大小: " << fixed << setprecision(2) << (file_size / (1024.0 * 1024.0 * 1024.0)) << " GB (" << file_size
          << " 字节)" << endl;
     cout << "测试块大小数量: " << NUM_BLOCK_SIZES << endl;
+    PerfCounters probe;
+    int num_counters = perf_counters_open(&probe);
+    perf_counters_close(&probe);
+    if (num_counters == 0)
+        cout << "硬件计数器: 不可用（perf_event_paranoid 限制或没有 PMU），显示 n/a" << endl;
+    else
+        cout << "硬件计数器: " << num_counters << "/" << PERF_NUM_EVENTS << " 个事件可用" << endl;
     cout << "\n开始测试...\n" << endl;
 
     print_result_header();
@@ -127,6 +154,10 @@ int main(int argc, char* argv[]) {
     for (int i = 0; i < NUM_BLOCK_SIZES; i++) {
         test_block_size(filepath, block_sizes[i].size, block_sizes[i].name);
         cout.flush();
+        if (compare_direct) {
+            test_block_size(filepath, block_sizes[i].size, block_sizes[i].name, true);
+            cout.flush();
+        }
     }
 
     cout << "\n测试完成！" << endl;
@@ -1,5 +1,6 @@
 #include "filelines_blocksize.h"
 
+#include "direct_io.h"
 #include "find_most_freq.h"
 
 #include <fcntl.h>
@@ -10,20 +11,28 @@
 #include <unistd.h>
 
 
-void filelines_with_blocksize(char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size) {
+bool filelines_with_blocksize(
+    char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size, bool direct_io) {
+    // O_DIRECT 的读取长度必须是对齐粒度的整数倍，更小或不对齐的块大小只能走页缓存
+    if (block_size % DIRECT_IO_ALIGN != 0)
+        direct_io = false;
+
     int handle;
-    if ((handle = open(filepath, O_RDONLY)) < 0)
-        return;
+    if ((handle = open_for_scan(filepath, direct_io)) < 0)
+        return false;
+    // open_for_scan 在文件系统不支持 O_DIRECT 时会退回普通打开，以描述符的实际标志为准
+    int flags = fcntl(handle, F_GETFL);
+    direct_io = direct_io && flags >= 0 && (flags & O_DIRECT);
 
-    char* bp = (char*)malloc(block_size);
+    char* bp = direct_io ? alloc_io_buffer(block_size) : (char*)malloc(block_size);
     if (bp == NULL) {
         close(handle);
-        return;
+        return false;
     }
 
     int cur_len = 0;
     while (1) {
-        ssize_t bytes_read = read(handle, bp, block_size);
+        ssize_t bytes_read = read_for_scan(handle, bp, block_size);
         if (bytes_read <= 0)
             break;
 
@@ -43,4 +52,5 @@ void filelines_with_blocksize(char* filepath, uint32_t* total_line_num, uint32_t
 
     free(bp);
     close(handle);
+    return direct_io;
 }
@@ -0,0 +1,124 @@
+#include "filelines_daemon.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const char* daemon_socket_path() {
+    const char* env = getenv(DAEMON_SOCKET_ENV);
+    return env && *env ? env : DAEMON_DEFAULT_SOCKET;
+}
+
+bool daemon_send_all(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t sent = send(fd, p, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        p += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool daemon_recv_all(int fd, void* data, size_t size) {
+    char* p = (char*)data;
+    while (size > 0) {
+        ssize_t received = recv(fd, p, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        p += received;
+        size -= received;
+    }
+    return true;
+}
+
+static int connect_daemon(const char* socket_path) {
+    if (socket_path == NULL)
+        socket_path = daemon_socket_path();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static int send_request(int fd, uint32_t op, uint32_t flags, const char* path) {
+    DaemonRequest request;
+    request.magic = DAEMON_MAGIC;
+    request.op = op;
+    request.flags = flags;
+    request.path_len = path ? (uint32_t)strlen(path) : 0;
+    if (!daemon_send_all(fd, &request, sizeof(request)) || (path && !daemon_send_all(fd, path, request.path_len))) {
+        errno = EPIPE;
+        return -1;
+    }
+    return 0;
+}
+
+int daemon_query(const char* socket_path, const char* filepath, uint32_t flags, LineHistogram* hist,
+                 DaemonResponse* response) {
+    // 守护进程的当前目录与调用方不同，只传绝对路径
+    char resolved[PATH_MAX];
+    if (realpath(filepath, resolved) == NULL)
+        return -1;
+
+    int fd = connect_daemon(socket_path);
+    if (fd < 0)
+        return -1;
+
+    DaemonResponse header;
+    int result = -1;
+    if (send_request(fd, DAEMON_OP_QUERY, flags, resolved) == 0) {
+        if (!daemon_recv_all(fd, &header, sizeof(header)) || header.magic != DAEMON_MAGIC) {
+            errno = EPROTO;
+        } else if (header.status != 0) {
+            errno = -header.status;
+        } else if (!daemon_recv_all(fd, hist, sizeof(LineHistogram))) {
+            errno = EPROTO;
+        } else {
+            result = 0;
+            if (response)
+                *response = header;
+        }
+    }
+    int saved = errno;
+    close(fd);
+    errno = saved;
+    return result;
+}
+
+int daemon_shutdown(const char* socket_path) {
+    int fd = connect_daemon(socket_path);
+    if (fd < 0)
+        return -1;
+    int result = send_request(fd, DAEMON_OP_SHUTDOWN, 0, NULL);
+    // 等守护进程关闭连接，返回时它已经停止接受新请求
+    char byte;
+    while (recv(fd, &byte, 1, 0) > 0) {
+    }
+    close(fd);
+    return result;
+}
@@ -0,0 +1,68 @@
+/*
+ * 文件行分析守护进程的命令行客户端
+ * 输出格式与 filelines --wide 相同，可以直接替换 filelines 调用
+ */
+
+#include "filelines_daemon.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char* argv[]) {
+    // 用法: filelines_client [-s socket] [--refresh] [-v] filepath ...
+    //       filelines_client [-s socket] --shutdown
+    // 每个文件输出一行 "总行数 最常见行长度 该长度的行数"（多个文件时行首加路径）
+    // --refresh 忽略缓存重新扫描；-v 在 stderr 输出结果是否来自缓存
+    const char* socket_path = NULL;
+    uint32_t flags = 0;
+    bool verbose = false;
+    bool shutdown = false;
+    int first_file = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--refresh") == 0) {
+            flags |= DAEMON_FLAG_REFRESH;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--shutdown") == 0) {
+            shutdown = true;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+    if (shutdown)
+        return daemon_shutdown(socket_path) == 0 ? 0 : -1;
+    if (first_file >= argc) {
+        printf("Usage: %s [-s socket] [--refresh] [-v] filepath ... | --shutdown\n", argv[0]);
+        return -1;
+    }
+
+    LineHistogram* hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+    if (!hist)
+        return -1;
+    int failed = 0;
+    bool multiple = argc - first_file > 1;
+    for (int i = first_file; i < argc; i++) {
+        DaemonResponse response;
+        if (daemon_query(socket_path, argv[i], flags, hist, &response) < 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+            failed++;
+            continue;
+        }
+        uint64_t most_freq_len, most_freq_len_linenum;
+        find_most_freq_line64(hist, &most_freq_len, &most_freq_len_linenum);
+        if (multiple)
+            printf("%s ", argv[i]);
+        printf("%" PRIu64 " %" PRIu64 " %" PRIu64 "\n", hist->total_line_num, most_freq_len, most_freq_len_linenum);
+        if (verbose)
+            fprintf(stderr, "%s: %s\n", argv[i], response.cached ? "cached" : "scanned");
+    }
+    free(hist);
+    return failed > 0 ? -1 : 0;
+}
@@ -0,0 +1,413 @@
+/*
+ * 文件行分析守护进程
+ * 常驻一个工作线程池（每个线程预先分配好读缓冲区和直方图），通过 Unix 域套接字接收查询，
+ * 结果按 (dev, inode, size, mtime) 缓存，多个工具反复查询同一个文件时不再重复扫描
+ */
+
+#include "direct_io.h"
+#include "filelines_daemon.h"
+#include "range_scan.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#define DAEMON_BLOCK_SIZE    (256 << 10) // 256KB，与 filelines_mt 相同的读取粒度
+#define DAEMON_RANGE_SIZE    (16 << 20)  // 文件按 16MB 切成区间，由空闲线程动态领取
+#define DAEMON_CACHE_ENTRIES 256         // 缓存的文件数（每个约 9KB），满了淘汰最久没用的
+#define DAEMON_IO_TIMEOUT    5           // 客户端读写超时（秒），卡住的客户端不会挡住后面的请求
+
+// 一次扫描任务：区间按编号由各线程原子领取
+struct ScanJob {
+    int handle;
+    off_t file_size;
+    int num_ranges;
+    std::atomic<int> next_range;
+    std::atomic<bool> failed; // 有区间读取出错或文件在扫描期间被截断
+    RangeBoundary* boundaries;
+};
+
+struct Worker {
+    char* buffer;        // 预分配的读缓冲区
+    LineHistogram* hist; // 本线程在当前任务中扫描到的完整行
+};
+
+// 常驻线程池：主线程发布任务后广播，所有线程领完区间后最后一个通知主线程
+struct WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+    uint64_t generation; // 每发布一个任务加一
+    int active;          // 还在处理当前任务的线程数
+    bool stopping;
+    ScanJob* job;
+
+    int num_workers;
+    Worker* workers;
+    pthread_t* threads;
+};
+
+struct WorkerArg {
+    WorkerPool* pool;
+    int worker_id;
+};
+
+static void* worker_thread(void* arg) {
+    WorkerPool* pool = ((WorkerArg*)arg)->pool;
+    Worker* worker = &pool->workers[((WorkerArg*)arg)->worker_id];
+    uint64_t seen = 0;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stopping && pool->generation == seen)
+            pthread_cond_wait(&pool->job_ready, &pool->lock);
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        ScanJob* job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+
+        line_histogram_init(worker->hist);
+        int r;
+        while ((r = job->next_range.fetch_add(1)) < job->num_ranges) {
+            off_t start = (off_t)r * DAEMON_RANGE_SIZE;
+            off_t end = start + DAEMON_RANGE_SIZE < job->file_size ? start + DAEMON_RANGE_SIZE : job->file_size;
+            if (!scan_file_range(job->handle, start, end, worker->buffer, DAEMON_BLOCK_SIZE, &job->boundaries[r],
+                                 worker->hist))
+                job->failed.store(true);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0)
+            pthread_cond_signal(&pool->job_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static int pool_start(WorkerPool* pool, int num_workers, WorkerArg** args) {
+    memset(pool, 0, sizeof(WorkerPool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_ready, NULL);
+    pthread_cond_init(&pool->job_done, NULL);
+    pool->num_workers = num_workers;
+    pool->workers = (Worker*)calloc(num_workers, sizeof(Worker));
+    pool->threads = (pthread_t*)calloc(num_workers, sizeof(pthread_t));
+    *args = (WorkerArg*)calloc(num_workers, sizeof(WorkerArg));
+    if (!pool->workers || !pool->threads || !*args)
+        return -1;
+    for (int i = 0; i < num_workers; i++) {
+        pool->workers[i].buffer = alloc_io_buffer(DAEMON_BLOCK_SIZE);
+        pool->workers[i].hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+        if (!pool->workers[i].buffer || !pool->workers[i].hist)
+            return -1;
+        // 先碰一遍缓冲区，第一次请求不用再承担缺页
+        memset(pool->workers[i].buffer, 0, DAEMON_BLOCK_SIZE);
+        line_histogram_init(pool->workers[i].hist);
+    }
+    for (int i = 0; i < num_workers; i++) {
+        (*args)[i].pool = pool;
+        (*args)[i].worker_id = i;
+        pthread_create(&pool->threads[i], NULL, worker_thread, &(*args)[i]);
+    }
+    return 0;
+}
+
+static void pool_stop(WorkerPool* pool, WorkerArg* args) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->job_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_workers && pool->threads; i++) {
+        if (pool->threads[i])
+            pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->num_workers && pool->workers; i++) {
+        free(pool->workers[i].buffer);
+        free(pool->workers[i].hist);
+    }
+    free(pool->workers);
+    free(pool->threads);
+    free(args);
+}
+
+// 用线程池扫描整个文件，结果与 filelines_mt_split_wide 一致；有区间没读完时返回 -EIO
+static int pool_scan(WorkerPool* pool, int handle, off_t file_size, LineHistogram* hist) {
+    line_histogram_init(hist);
+    ScanJob job;
+    job.handle = handle;
+    job.file_size = file_size;
+    job.num_ranges = (int)((file_size + DAEMON_RANGE_SIZE - 1) / DAEMON_RANGE_SIZE);
+    job.next_range.store(0);
+    job.failed.store(false);
+    if (job.num_ranges == 0)
+        return 0;
+    job.boundaries = (RangeBoundary*)calloc(job.num_ranges, sizeof(RangeBoundary));
+    if (!job.boundaries)
+        return -ENOMEM;
+    posix_fadvise(handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job = &job;
+    pool->active = pool->num_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->job_ready);
+    while (pool->active > 0)
+        pthread_cond_wait(&pool->job_done, &pool->lock);
+    pool->job = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    // 不完整的结果不能返回给客户端，也不能进缓存（之后的查询会一直拿到错误的结果）
+    if (job.failed.load()) {
+        free(job.boundaries);
+        return -EIO;
+    }
+    for (int i = 0; i < pool->num_workers; i++)
+        line_histogram_merge(hist, pool->workers[i].hist);
+    stitch_ranges(job.boundaries, job.num_ranges, hist);
+    free(job.boundaries);
+    return 0;
+}
+
+// 结果缓存：(dev, inode) 相同但大小或修改时间变了的条目视为过期，会被新结果替换
+struct CacheEntry {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t last_used;
+    LineHistogram* hist;
+};
+
+struct ResultCache {
+    std::vector<CacheEntry> entries;
+    uint64_t clock;
+};
+
+static CacheEntry* cache_find(ResultCache* cache, const struct stat* st, bool* fresh) {
+    for (size_t i = 0; i < cache->entries.size(); i++) {
+        CacheEntry* entry = &cache->entries[i];
+        if (entry->dev == (uint64_t)st->st_dev && entry->ino == (uint64_t)st->st_ino) {
+            *fresh = entry->size == (uint64_t)st->st_size && entry->mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+                     entry->mtime_nsec == (int64_t)st->st_mtim.tv_nsec;
+            entry->last_used = ++cache->clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_store(ResultCache* cache, const struct stat* st, const LineHistogram* hist) {
+    bool fresh;
+    CacheEntry* entry = cache_find(cache, st, &fresh);
+    if (!entry && cache->entries.size() >= DAEMON_CACHE_ENTRIES) {
+        // 淘汰最久没用的条目，复用它的直方图
+        entry = &cache->entries[0];
+        for (size_t i = 1; i < cache->entries.size(); i++) {
+            if (cache->entries[i].last_used < entry->last_used)
+                entry = &cache->entries[i];
+        }
+    }
+    if (!entry) {
+        CacheEntry created;
+        created.hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+        if (!created.hist)
+            return;
+        cache->entries.push_back(created);
+        entry = &cache->entries.back();
+    }
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+    entry->mtime_sec = st->st_mtim.tv_sec;
+    entry->mtime_nsec = st->st_mtim.tv_nsec;
+    entry->last_used = ++cache->clock;
+    memcpy(entry->hist, hist, sizeof(LineHistogram));
+}
+
+// 处理一个查询，返回 status（0 或负的 errno），结果写入 hist
+static int handle_query(WorkerPool* pool, ResultCache* cache, const char* path, uint32_t flags,
+                        DaemonResponse* response, LineHistogram* hist) {
+    // O_NONBLOCK：路径是 FIFO 时 open 不会卡住整个守护进程，对普通文件没有影响
+    int handle = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (handle < 0)
+        return -errno;
+    struct stat st;
+    if (fstat(handle, &st) < 0) {
+        int status = -errno;
+        close(handle);
+        return status;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(handle);
+        return -EINVAL;
+    }
+    response->dev = st.st_dev;
+    response->ino = st.st_ino;
+    response->size = st.st_size;
+    response->mtime_sec = st.st_mtim.tv_sec;
+    response->mtime_nsec = st.st_mtim.tv_nsec;
+
+    bool fresh = false;
+    CacheEntry* entry = cache_find(cache, &st, &fresh);
+    if (entry && fresh && !(flags & DAEMON_FLAG_REFRESH)) {
+        memcpy(hist, entry->hist, sizeof(LineHistogram));
+        response->cached = 1;
+        close(handle);
+        return 0;
+    }
+
+    int status = pool_scan(pool, handle, st.st_size, hist);
+    close(handle);
+    if (status == 0)
+        cache_store(cache, &st, hist);
+    return status;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) { stop_requested = 1; }
+
+// 绑定套接字；路径上有残留的套接字文件但没有守护进程在监听时先删除它
+static int listen_socket(const char* socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        close(probe);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    if (probe >= 0)
+        close(probe);
+    unlink(socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    // 只允许同一用户访问
+    mode_t old_mask = umask(0077);
+    int bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_mask);
+    if (bound < 0 || listen(fd, 64) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    // 用法: filelines_daemon [-s socket] [-j threads]
+    // 在前台运行，收到 SIGINT/SIGTERM 或 DAEMON_OP_SHUTDOWN 请求后删除套接字并退出
+    // 套接字默认为 $FILELINES_SOCKET，未设置时为 /tmp/filelines.sock
+    const char* socket_path = daemon_socket_path();
+    int num_threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else {
+            printf("Usage: %s [-s socket] [-j threads]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (num_threads <= 0)
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int listen_fd = listen_socket(socket_path);
+    if (listen_fd < 0) {
+        fprintf(stderr, "无法监听 %s: %s\n", socket_path, strerror(errno));
+        return -1;
+    }
+
+    // 不设置 SA_RESTART，收到信号时 accept 返回 EINTR，主循环检查退出标志
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    WorkerPool pool;
+    WorkerArg* args = NULL;
+    LineHistogram* hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+    char* path = (char*)malloc(DAEMON_MAX_PATH + 1);
+    if (pool_start(&pool, num_threads, &args) < 0 || !hist || !path) {
+        fprintf(stderr, "内存不足\n");
+        close(listen_fd);
+        unlink(socket_path);
+        return -1;
+    }
+    ResultCache cache;
+    cache.clock = 0;
+    fprintf(stderr, "filelines_daemon: %d 个工作线程，监听 %s\n", num_threads, socket_path);
+
+    // 请求逐个处理：一次扫描已经用上了整个线程池
+    while (!stop_requested) {
+        int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+            continue;
+        struct timeval timeout = {DAEMON_IO_TIMEOUT, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        DaemonRequest request;
+        if (!daemon_recv_all(client, &request, sizeof(request)) || request.magic != DAEMON_MAGIC) {
+            close(client);
+            continue;
+        }
+        if (request.op == DAEMON_OP_SHUTDOWN) {
+            stop_requested = 1;
+            close(client);
+            break;
+        }
+
+        DaemonResponse response;
+        memset(&response, 0, sizeof(response));
+        response.magic = DAEMON_MAGIC;
+        if (request.op != DAEMON_OP_QUERY || request.path_len == 0 || request.path_len > DAEMON_MAX_PATH) {
+            response.status = -EINVAL;
+        } else if (!daemon_recv_all(client, path, request.path_len)) {
+            close(client);
+            continue;
+        } else {
+            path[request.path_len] = '\0';
+            response.status = handle_query(&pool, &cache, path, request.flags, &response, hist);
+        }
+        if (daemon_send_all(client, &response, sizeof(response)) && response.status == 0)
+            daemon_send_all(client, hist, sizeof(LineHistogram));
+        close(client);
+    }
+
+    close(listen_fd);
+    unlink(socket_path);
+    pool_stop(&pool, args);
+    for (size_t i = 0; i < cache.entries.size(); i++)
+        free(cache.entries[i].hist);
+    free(hist);
+    free(path);
+    return 0;
+}
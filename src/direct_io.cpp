@@ -0,0 +1,54 @@
+#include "direct_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int open_for_scan(const char* filepath, bool direct) {
+    if (direct) {
+        int handle = open(filepath, O_RDONLY | O_DIRECT);
+        if (handle >= 0 || errno != EINVAL)
+            return handle;
+    }
+    return open(filepath, O_RDONLY);
+}
+
+char* alloc_io_buffer(size_t size) {
+    size_t aligned_size = (size + DIRECT_IO_ALIGN - 1) / DIRECT_IO_ALIGN * DIRECT_IO_ALIGN;
+    return (char*)aligned_alloc(DIRECT_IO_ALIGN, aligned_size);
+}
+
+// 经 /proc/self/fd 重新以普通方式打开同一个文件，读取这一次请求
+// 描述符可能被多个扫描线程共享，不能用 F_SETFL 去掉 O_DIRECT，否则其他线程也会悄悄改走页缓存
+static ssize_t read_buffered(int handle, char* buffer, size_t size, off_t offset) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", handle);
+    int buffered = open(path, O_RDONLY);
+    if (buffered < 0)
+        return -1;
+
+    bool sequential = offset < 0;
+    if (sequential)
+        offset = lseek(handle, 0, SEEK_CUR);
+    ssize_t bytes_read = offset < 0 ? -1 : pread(buffered, buffer, size, offset);
+    int saved_errno = errno;
+    close(buffered);
+    // read() 方式需要和直接读取一样推进原描述符的文件位置
+    if (sequential && bytes_read > 0)
+        lseek(handle, bytes_read, SEEK_CUR);
+    errno = saved_errno;
+    return bytes_read;
+}
+
+ssize_t read_for_scan(int handle, char* buffer, size_t size, off_t offset) {
+    ssize_t bytes_read = offset < 0 ? read(handle, buffer, size) : pread(handle, buffer, size, offset);
+    if (bytes_read < 0 && errno == EINVAL) {
+        // 不满足 O_DIRECT 对齐要求（通常是文件或区间末尾不足4KB的部分）：只有这一次改走页缓存
+        int flags = fcntl(handle, F_GETFL);
+        if (flags >= 0 && (flags & O_DIRECT))
+            bytes_read = read_buffered(handle, buffer, size, offset);
+    }
+    return bytes_read;
+}
@@ -0,0 +1,72 @@
+#include "huge_pages.h"
+
+#include <stdint.h>
+#include <sys/mman.h>
+
+static bool huge_pages_on = false;
+
+static size_t round_up_huge(size_t size) {
+    return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+void* huge_alloc(size_t size, HugePageKind* kind) {
+    if (size == 0)
+        size = 1;
+    size = round_up_huge(size);
+
+#ifdef MAP_HUGETLB
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+        if (kind)
+            *kind = HUGE_PAGE_HUGETLB;
+        return addr;
+    }
+#endif
+
+    // 多映射 2MB 再裁掉首尾，得到 2MB 对齐的区间，透明大页才能按整页合并
+    char* raw = (char*)mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+    char* aligned = (char*)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+    if (aligned > raw)
+        munmap(raw, aligned - raw);
+    size_t tail = raw + size + HUGE_PAGE_SIZE - (aligned + size);
+    if (tail > 0)
+        munmap(aligned + size, tail);
+
+    HugePageKind result = HUGE_PAGE_NONE;
+#ifdef MADV_HUGEPAGE
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0)
+        result = HUGE_PAGE_THP;
+#endif
+    if (kind)
+        *kind = result;
+    return aligned;
+}
+
+void huge_free(void* ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+    if (size == 0)
+        size = 1;
+    munmap(ptr, round_up_huge(size));
+}
+
+void huge_pages_set_enabled(bool enabled) {
+    huge_pages_on = enabled;
+}
+
+bool huge_pages_enabled() {
+    return huge_pages_on;
+}
+
+const char* huge_page_kind_name(HugePageKind kind) {
+    switch (kind) {
+    case HUGE_PAGE_HUGETLB:
+        return "hugetlb";
+    case HUGE_PAGE_THP:
+        return "thp";
+    default:
+        return "4k";
+    }
+}
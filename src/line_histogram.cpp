@@ -0,0 +1,40 @@
+#include "line_histogram.h"
+
+#include <string.h>
+
+void line_histogram_init(LineHistogram* hist) { memset(hist, 0, sizeof(LineHistogram)); }
+
+void line_histogram_merge(LineHistogram* dst, const LineHistogram* src) {
+    dst->total_line_num += src->total_line_num;
+    for (int i = 0; i < MAX_LEN; i++)
+        dst->dense[i] += src->dense[i];
+    for (int k = 0; k < LONG_LINE_BUCKETS; k++) {
+        dst->long_lines[k] += src->long_lines[k];
+        dst->long_line_bytes[k] += src->long_line_bytes[k];
+    }
+    if (src->max_line_len > dst->max_line_len)
+        dst->max_line_len = src->max_line_len;
+}
+
+void line_histogram_to_legacy(const LineHistogram* hist, uint32_t* total_line_num, uint32_t* line_num) {
+    *total_line_num += (uint32_t)hist->total_line_num;
+    for (int i = 0; i < MAX_LEN; i++)
+        line_num[i] += (uint32_t)hist->dense[i];
+    for (int k = 0; k < LONG_LINE_BUCKETS; k++)
+        line_num[MAX_LEN - 1] += (uint32_t)hist->long_lines[k];
+}
+
+void find_most_freq_line64(const LineHistogram* hist, uint64_t* most_freq_len, uint64_t* most_freq_len_linenum) {
+    // 与 find_most_freq_line 相同：先向量化求最大值，再找第一个位置
+    uint64_t t_linenum = 0;
+    for (int i = 0; i < MAX_LEN; i++)
+        t_linenum = hist->dense[i] > t_linenum ? hist->dense[i] : t_linenum;
+
+    uint64_t t_len = 0;
+    if (t_linenum > 0) {
+        while (hist->dense[t_len] != t_linenum)
+            t_len++;
+    }
+    *most_freq_len = t_len;
+    *most_freq_len_linenum = t_linenum;
+}
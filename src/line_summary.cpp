@@ -0,0 +1,132 @@
+#include "line_summary.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// 长行桶 k 的代表长度：桶内平均长度，不超过已知的最大行长度
+static uint64_t long_bucket_len(const LineHistogram* hist, int k) {
+    uint64_t len = hist->long_line_bytes[k] / hist->long_lines[k];
+    return len < hist->max_line_len ? len : hist->max_line_len;
+}
+
+// 把 (len, count) 插入按次数降序排列的 top-K 表
+static void insert_top(LineSummary* summary, int capacity, uint64_t len, uint64_t count) {
+    int pos = summary->top_k < capacity ? summary->top_k++ : capacity - 1;
+    // 次数相同时先出现的（长度更小的）排在前面
+    while (pos > 0 && summary->top_count[pos - 1] < count) {
+        summary->top_len[pos] = summary->top_len[pos - 1];
+        summary->top_count[pos] = summary->top_count[pos - 1];
+        pos--;
+    }
+    summary->top_len[pos] = len;
+    summary->top_count[pos] = count;
+}
+
+void line_histogram_summary(const LineHistogram* hist, int top_k, const double* percentiles, int num_percentiles,
+                            LineSummary* summary) {
+    memset(summary, 0, sizeof(LineSummary));
+    if (top_k > SUMMARY_MAX_TOP_K)
+        top_k = SUMMARY_MAX_TOP_K;
+    if (num_percentiles > SUMMARY_MAX_PERCENTILES)
+        num_percentiles = SUMMARY_MAX_PERCENTILES;
+    if (percentiles == NULL)
+        num_percentiles = 0;
+
+    // 第一级：不依赖前一次迭代的整数求和，-O3 下按 SIMD 宽度展开
+    const uint64_t* dense = hist->dense;
+    uint64_t count = 0, sum = 0, sum_sq = 0;
+    for (int i = 0; i < MAX_LEN; i++) {
+        count += dense[i];
+        sum += dense[i] * (uint64_t)i;
+        sum_sq += dense[i] * (uint64_t)(i * i);
+    }
+    double total_sum = (double)sum;
+    double total_sq = (double)sum_sq;
+    for (int k = 0; k < LONG_LINE_BUCKETS; k++) {
+        if (hist->long_lines[k] == 0)
+            continue;
+        double mean_len = (double)hist->long_line_bytes[k] / hist->long_lines[k];
+        count += hist->long_lines[k];
+        total_sum += (double)hist->long_line_bytes[k];
+        total_sq += mean_len * mean_len * hist->long_lines[k];
+    }
+    summary->total_line_num = count;
+    if (count == 0) {
+        summary->num_percentiles = num_percentiles;
+        for (int p = 0; p < num_percentiles; p++)
+            summary->percentile[p] = percentiles[p];
+        return;
+    }
+    summary->mean = total_sum / count;
+    double variance = total_sq / count - summary->mean * summary->mean;
+    summary->stddev = variance > 0 ? sqrt(variance) : 0;
+
+    // 每个百分位对应的秩（最近秩法：第 ceil(p / 100 * N) 小的行）
+    uint64_t rank[SUMMARY_MAX_PERCENTILES];
+    summary->num_percentiles = num_percentiles;
+    for (int p = 0; p < num_percentiles; p++) {
+        double q = percentiles[p] < 0 ? 0 : (percentiles[p] > 100 ? 100 : percentiles[p]);
+        summary->percentile[p] = percentiles[p];
+        rank[p] = (uint64_t)ceil(q / 100.0 * count);
+        if (rank[p] == 0)
+            rank[p] = 1;
+    }
+
+    // 一次遍历：前缀和定位百分位，同时维护 top-K 和最小/最大长度
+    bool has_min = false;
+    uint64_t prefix = 0;
+    for (int i = 0; i < MAX_LEN; i++) {
+        uint64_t c = dense[i];
+        if (c == 0)
+            continue;
+        if (!has_min) {
+            summary->min_len = i;
+            has_min = true;
+        }
+        summary->max_len = i;
+        if (top_k > 0 && (summary->top_k < top_k || c > summary->top_count[top_k - 1]))
+            insert_top(summary, top_k, i, c);
+        for (int p = 0; p < num_percentiles; p++) {
+            if (prefix < rank[p] && rank[p] <= prefix + c)
+                summary->percentile_len[p] = i;
+        }
+        prefix += c;
+    }
+    for (int k = 0; k < LONG_LINE_BUCKETS; k++) {
+        uint64_t c = hist->long_lines[k];
+        if (c == 0)
+            continue;
+        if (!has_min) {
+            summary->min_len = 1ULL << k;
+            has_min = true;
+        }
+        for (int p = 0; p < num_percentiles; p++) {
+            if (prefix < rank[p] && rank[p] <= prefix + c)
+                summary->percentile_len[p] = long_bucket_len(hist, k);
+        }
+        prefix += c;
+    }
+    // 有长行时最大值以两级直方图记录的精确值为准
+    if (hist->max_line_len > summary->max_len)
+        summary->max_len = hist->max_line_len;
+}
+
+void line_histogram_from_legacy(LineHistogram* hist, uint32_t total_line_num, const uint32_t* line_num) {
+    line_histogram_init(hist);
+    hist->total_line_num = total_line_num;
+    for (int i = 0; i < MAX_LEN; i++)
+        hist->dense[i] = line_num[i];
+}
+
+void print_line_summary(const LineSummary* summary) {
+    printf("min %" PRIu64 " max %" PRIu64 " mean %.2f stddev %.2f\n", summary->min_len, summary->max_len, summary->mean,
+           summary->stddev);
+    for (int p = 0; p < summary->num_percentiles; p++)
+        printf("p%g %" PRIu64 "\n", summary->percentile[p], summary->percentile_len[p]);
+    printf("top");
+    for (int i = 0; i < summary->top_k; i++)
+        printf(" %" PRIu64 ":%" PRIu64, summary->top_len[i], summary->top_count[i]);
+    printf("\n");
+}
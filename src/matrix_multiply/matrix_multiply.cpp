@@ -3,8 +3,17 @@
 包含基本矩阵乘法、分块矩阵乘法、SSE/AVX优化、以及多线程版本的实现和测试
 */
 
+#include "bench_harness.h"
+#include "huge_pages.h"
+#include "numa_topology.h"
+#include "perf_counters.h"
+
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <immintrin.h>
 #include <iomanip>
 #include <iostream>
@@ -14,6 +23,9 @@
 #define BLOCK_SIZE 64
 #define THREAD_NUM 32
 
+// 矩阵存储：打开大页开关（huge_pages_set_enabled）后由 huge_alloc 分配
+typedef std::vector<float, HugePageAllocator<float>> MatrixStorage;
+
 float rand_float(float s) { return 4.0f * s * (1.0f - s); }
 
 void matrix_gen(float* a, float* b, int N, float seed) {
@@ -46,22 +58,34 @@ template <typename MultiplyFunc>
 void run_matrix_multiply_test(const std::string& name, int N, float seed, MultiplyFunc multiply_func) {
     std::cout << name << " N=" << N << " seed=" << seed << std::endl;
 
-    std::vector<float> a((long long)N * N);
-    std::vector<float> b((long long)N * N);
-    std::vector<float> c((long long)N * N);
+    HugePageAllocator<float> alloc(huge_pages_enabled());
+    MatrixStorage a((long long)N * N, alloc);
+    MatrixStorage b((long long)N * N, alloc);
+    MatrixStorage c((long long)N * N, alloc);
 
     matrix_gen(a.data(), b.data(), N, seed);
 
+    // 计数器继承到多线程版本创建的工作线程
+    PerfCounters counters;
+    perf_counters_open(&counters);
+
+    perf_counters_start(&counters);
     auto start = std::chrono::high_resolution_clock::now();
     multiply_func(a.data(), b.data(), c.data(), N);
     auto end = std::chrono::high_resolution_clock::now();
+    PerfSample perf;
+    perf_counters_stop(&counters, &perf);
+    perf_counters_close(&counters);
 
     std::chrono::duration<double> duration = end - start;
     float trace = calculate_trace(c.data(), N);
 
+    char perf_line[256];
+    perf_sample_format(&perf, perf_line, sizeof(perf_line));
     std::cout << std::fixed << std::setprecision(6);
     std::cout << "Trace: " << trace << std::endl;
     std::cout << "计算时间(s): " << duration.count() << std::endl;
+    std::cout << "硬件计数器: " << perf_line << std::endl;
 }
 
 void matrix_multiply(float* a, float* b, float* c, int N) {
@@ -333,6 +357,36 @@ void matrix_multiply_blocked_avx_mt_worker(float* a, float* b, float* c, int N,
     }
 }
 
+// NUMA 绑核版本的 worker：先绑到所属节点，再把负责的 a、c 行复制到本线程首次写入的行面板里计算，
+// 算完写回。复制是 O(rows*N)，相对 O(rows*N*N) 的计算可以忽略；b 被所有线程读取，仍然共享一份
+void matrix_multiply_blocked_avx_mt_numa_worker(
+    float* a, float* b, float* c, int N, int m, int start_row, int end_row, int worker, int num_workers) {
+    if (numa_bind_worker(worker, num_workers) < 0) {
+        matrix_multiply_blocked_avx_mt_worker(a, b, c, N, m, start_row, end_row);
+        return;
+    }
+
+    int rows = end_row - start_row;
+    size_t panel_size = (size_t)rows * N * sizeof(float);
+    size_t aligned_size = (panel_size + 63) / 64 * 64;
+    float* a_panel = (float*)aligned_alloc(64, aligned_size);
+    float* c_panel = (float*)aligned_alloc(64, aligned_size);
+    if (!a_panel || !c_panel) {
+        free(a_panel);
+        free(c_panel);
+        matrix_multiply_blocked_avx_mt_worker(a, b, c, N, m, start_row, end_row);
+        return;
+    }
+
+    memcpy(a_panel, &a[(size_t)start_row * N], panel_size);
+    memcpy(c_panel, &c[(size_t)start_row * N], panel_size);
+    matrix_multiply_blocked_avx_mt_worker(a_panel, b, c_panel, N, m, 0, rows);
+    memcpy(&c[(size_t)start_row * N], c_panel, panel_size);
+
+    free(a_panel);
+    free(c_panel);
+}
+
 void matrix_multiply_blocked_avx_mt(float* a, float* b, float* c, int N, int m, int num_threads) {
     // clear_matrix(c, N);
 
@@ -353,7 +407,12 @@ void matrix_multiply_blocked_avx_mt(float* a, float* b, float* c, int N, int m,
             continue;
 
         // 调用新的、高性能的 worker 函数！
-        threads.emplace_back(matrix_multiply_blocked_avx_mt_worker, a, b, c, N, m, start_row, end_row);
+        // 需要 NUMA 绑核时（多节点机器默认打开，见 numa_topology.h）使用行面板版本
+        if (numa_placement())
+            threads.emplace_back(
+                matrix_multiply_blocked_avx_mt_numa_worker, a, b, c, N, m, start_row, end_row, t, num_threads);
+        else
+            threads.emplace_back(matrix_multiply_blocked_avx_mt_worker, a, b, c, N, m, start_row, end_row);
     }
 
     for (auto& thread : threads) {
@@ -371,28 +430,274 @@ void blocked_multiply_avx_mt(int num_threads, int N = 4096, float seed = 0.12345
                              });
 }
 
-// 测试不同线程数的性能
-void test_multithreaded_performance(int N = 4096, float seed = 0.12345f) {
-    std::cout << "\n========== 多线程性能对比测试 ==========" << std::endl;
+// 对比 NUMA 绑核和不绑核（内核调度）的多线程版本，每种各跑 repeat 次，输出最快/平均/最慢时间和波动
+void test_numa_placement(int N = 4096, float seed = 0.12345f, int repeat = 5) {
+    NumaTopology topo;
+    numa_topology_detect(&topo);
+    std::cout << "\n========== NUMA 绑核对比测试 ==========" << std::endl;
+    std::cout << "N=" << N << " seed=" << seed << " threads=" << THREAD_NUM << " NUMA节点=" << topo.num_nodes
+              << std::endl;
+
+    std::vector<float> a((long long)N * N);
+    std::vector<float> b((long long)N * N);
+    std::vector<float> c((long long)N * N);
+    matrix_gen(a.data(), b.data(), N, seed);
+
+    const struct {
+        const char* name;
+        NumaPlacement mode;
+    } modes[] = {{"不绑核", NUMA_PLACEMENT_OFF}, {"NUMA绑核", NUMA_PLACEMENT_ON}};
+
+    for (const auto& mode : modes) {
+        numa_set_placement(mode.mode);
+        std::vector<double> times;
+        float trace = 0.0f;
+        for (int r = 0; r < repeat; ++r) {
+            clear_matrix(c.data(), N);
+            auto start = std::chrono::high_resolution_clock::now();
+            matrix_multiply_blocked_avx_mt(a.data(), b.data(), c.data(), N, BLOCK_SIZE, THREAD_NUM);
+            auto end = std::chrono::high_resolution_clock::now();
+            times.push_back(std::chrono::duration<double>(end - start).count());
+            trace = calculate_trace(c.data(), N);
+        }
+
+        double min_time = *std::min_element(times.begin(), times.end());
+        double max_time = *std::max_element(times.begin(), times.end());
+        double avg_time = 0.0;
+        for (double t : times)
+            avg_time += t / repeat;
+        std::cout << "\n--- " << mode.name << " ---" << std::endl;
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "Trace: " << trace << std::endl;
+        std::cout << "计算时间(s): 最快 " << min_time << " 平均 " << avg_time << " 最慢 " << max_time << std::endl;
+        std::cout << std::setprecision(1) << "波动: " << (max_time - min_time) / avg_time * 100 << "%" << std::endl;
+    }
+    numa_set_placement(NUMA_PLACEMENT_AUTO);
 
-    // 单线程基准
-    std::cout << "--- 单线程（基准） ---" << std::endl;
-    blocked_multiply_avx_mt(1, N, seed);
+    std::cout << "\n======================================" << std::endl;
+}
+
+// 对比普通页和大页存储的多线程版本：每种各跑 repeat 次，输出最快时间、dTLB 读缺失和加速比
+void test_huge_pages(int N = 4096, float seed = 0.12345f, int repeat = 3) {
+    std::cout << "\n========== 大页对比测试 ==========" << std::endl;
+    std::cout << "N=" << N << " seed=" << seed << " threads=" << THREAD_NUM << std::endl;
+
+    double best_time[2];
+    PerfSample best_perf[2];
+    for (int huge = 0; huge < 2; ++huge) {
+        HugePageKind kind = HUGE_PAGE_NONE;
+        if (huge) {
+            // 探测一次实际能拿到的页类型（hugetlb 或透明大页）
+            void* probe = huge_alloc(HUGE_PAGE_SIZE, &kind);
+            huge_free(probe, HUGE_PAGE_SIZE);
+        }
+        HugePageAllocator<float> alloc(huge != 0);
+        MatrixStorage a((long long)N * N, alloc);
+        MatrixStorage b((long long)N * N, alloc);
+        MatrixStorage c((long long)N * N, alloc);
+        matrix_gen(a.data(), b.data(), N, seed);
+
+        best_time[huge] = 0.0;
+        float trace = 0.0f;
+        for (int r = 0; r < repeat; ++r) {
+            clear_matrix(c.data(), N);
+            PerfCounters counters;
+            perf_counters_open(&counters);
+            perf_counters_start(&counters);
+            auto start = std::chrono::high_resolution_clock::now();
+            matrix_multiply_blocked_avx_mt(a.data(), b.data(), c.data(), N, BLOCK_SIZE, THREAD_NUM);
+            auto end = std::chrono::high_resolution_clock::now();
+            PerfSample perf;
+            perf_counters_stop(&counters, &perf);
+            perf_counters_close(&counters);
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            if (r == 0 || seconds < best_time[huge]) {
+                best_time[huge] = seconds;
+                best_perf[huge] = perf;
+            }
+            trace = calculate_trace(c.data(), N);
+        }
 
-    // 测试不同线程数
-    for (int threads : {2, 4, 6, 8, 12, 16, 32, 64}) {
-        std::cout << "\n--- " << threads << " 线程 ---" << std::endl;
-        blocked_multiply_avx_mt(threads, N, seed);
+        std::cout << "\n--- " << (huge ? "大页" : "普通页") << " (" << huge_page_kind_name(kind) << ") ---" << std::endl;
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "Trace: " << trace << std::endl;
+        std::cout << "计算时间(s): " << best_time[huge] << std::endl;
+        char perf_line[256];
+        perf_sample_format(&best_perf[huge], perf_line, sizeof(perf_line));
+        std::cout << "硬件计数器: " << perf_line << std::endl;
     }
 
+    std::cout << "\n加速比: " << std::setprecision(2) << best_time[0] / best_time[1] << "x" << std::endl;
+    double normal_misses = best_perf[0].value[PERF_EVENT_DTLB_MISSES];
+    double huge_misses = best_perf[1].value[PERF_EVENT_DTLB_MISSES];
+    if (best_perf[0].valid[PERF_EVENT_DTLB_MISSES] && best_perf[1].valid[PERF_EVENT_DTLB_MISSES] && normal_misses > 0)
+        std::cout << "dTLB 读缺失减少: " << std::setprecision(1) << (1.0 - huge_misses / normal_misses) * 100 << "%"
+                  << std::endl;
+    else
+        std::cout << "dTLB 读缺失: 不可用（没有硬件性能计数器）" << std::endl;
+
     std::cout << "\n======================================" << std::endl;
 }
 
+void print_usage(const char* prog_name);
+
+// bench_harness 版本：每次运行前清零 c，digest 为 trace 的位模式
+struct MatrixBenchCase {
+    BenchCase base;
+    void (*kernel)(float* a, float* b, float* c, int N, int threads);
+    int N;
+    int threads; // 只有多线程内核使用
+    float* a;
+    float* b;
+    float* c;
+    float trace;
+};
+
+// 待测内核
+struct MatrixKernel {
+    std::string name;
+    void (*kernel)(float* a, float* b, float* c, int N, int threads);
+    int threads;
+};
+
+static void matrix_bench_setup(BenchCase* bc) {
+    MatrixBenchCase* mc = (MatrixBenchCase*)bc;
+    clear_matrix(mc->c, mc->N);
+}
+
+static void matrix_bench_run(BenchCase* bc) {
+    MatrixBenchCase* mc = (MatrixBenchCase*)bc;
+    mc->kernel(mc->a, mc->b, mc->c, mc->N, mc->threads);
+    mc->trace = calculate_trace(mc->c, mc->N);
+    uint32_t bits;
+    memcpy(&bits, &mc->trace, sizeof(bits));
+    bc->digest = bits;
+}
+
+// 用 bench_harness 预热并自适应重复运行各内核，输出统计量并检查各内核的 trace（可写 JSON/CSV/结果库）
+static int bench_matrix(const char* benchmark, int N, float seed, const std::vector<MatrixKernel>& kernels,
+                        const BenchConfig* config) {
+    HugePageAllocator<float> alloc(huge_pages_enabled());
+    MatrixStorage a((long long)N * N, alloc);
+    MatrixStorage b((long long)N * N, alloc);
+    MatrixStorage c((long long)N * N, alloc);
+    matrix_gen(a.data(), b.data(), N, seed);
+
+    const int num_kernels = kernels.size();
+    std::vector<MatrixBenchCase> cases(num_kernels);
+    std::vector<BenchCase*> list;
+    for (int k = 0; k < num_kernels; ++k) {
+        MatrixBenchCase* mc = &cases[k];
+        mc->base.name = kernels[k].name.c_str();
+        mc->base.setup = matrix_bench_setup;
+        mc->base.run = matrix_bench_run;
+        mc->base.work = 2.0 * N * N * N / 1e9; // GFLOP
+        mc->base.unit = "GFLOPS";
+        mc->base.digest = 0;
+        mc->kernel = kernels[k].kernel;
+        mc->N = N;
+        mc->threads = kernels[k].threads;
+        mc->a = a.data();
+        mc->b = b.data();
+        mc->c = c.data();
+        mc->trace = 0.0f;
+        list.push_back(&mc->base);
+    }
+
+    std::vector<BenchResult> results;
+    std::cout << std::endl;
+    bench_run_all(list, config, &results);
+    std::cout << std::endl;
+    bench_print_results(results);
+
+    // 各内核的 trace 应该非常接近（求和顺序不同，允许相对误差）
+    std::cout << "\nTrace:" << std::endl;
+    bool ok = true;
+    for (int k = 0; k < num_kernels; ++k) {
+        float diff = std::abs(cases[k].trace - cases[0].trace);
+        bool match = results[k].stable && diff <= std::abs(cases[0].trace) * 1e-3f;
+        ok = ok && match;
+        std::cout << "  " << std::left << std::setw(32) << kernels[k].name << std::fixed << std::setprecision(6)
+                  << cases[k].trace << (match ? " ✓" : " ✗") << std::endl;
+    }
+    if (!bench_emit(config, benchmark, results))
+        ok = false;
+
+    std::cout << "\n======================================" << std::endl;
+    return ok ? 0 : 1;
+}
+
+// 所有内核的基准测试
+int bench_matrix_kernels(int N, float seed, const BenchConfig* config) {
+    std::cout << "\n========== 矩阵乘法内核基准测试 ==========" << std::endl;
+    std::cout << "N=" << N << " seed=" << seed << " threads=" << THREAD_NUM
+              << (huge_pages_enabled() ? " 大页" : "") << std::endl;
+
+    std::vector<MatrixKernel> kernels = {
+        {"matrix_multiply", [](float* a, float* b, float* c, int N, int) { matrix_multiply(a, b, c, N); }, 1},
+        {"blocked",
+         [](float* a, float* b, float* c, int N, int) { matrix_multiply_blocked(a, b, c, N, BLOCK_SIZE); }, 1},
+        {"blocked_sse",
+         [](float* a, float* b, float* c, int N, int) { matrix_multiply_blocked_sse(a, b, c, N, BLOCK_SIZE); }, 1},
+        {"blocked_avx",
+         [](float* a, float* b, float* c, int N, int) { matrix_multiply_blocked_avx(a, b, c, N, BLOCK_SIZE); }, 1},
+        {"blocked_avx_mt",
+         [](float* a, float* b, float* c, int N, int threads) {
+             matrix_multiply_blocked_avx_mt(a, b, c, N, BLOCK_SIZE, threads);
+         },
+         THREAD_NUM},
+    };
+    return bench_matrix("matrix_multiply", N, seed, kernels, config);
+}
+
+// 测试不同线程数的性能（第一个为单线程基准）
+int test_multithreaded_performance(int N, float seed, const BenchConfig* config) {
+    std::cout << "\n========== 多线程性能对比测试 ==========" << std::endl;
+    std::cout << "N=" << N << " seed=" << seed << (huge_pages_enabled() ? " 大页" : "") << std::endl;
+
+    std::vector<MatrixKernel> kernels;
+    for (int threads : {1, 2, 4, 6, 8, 12, 16, 32, 64}) {
+        kernels.push_back({"blocked_avx_mt (threads=" + std::to_string(threads) + ")",
+                           [](float* a, float* b, float* c, int N, int threads) {
+                               matrix_multiply_blocked_avx_mt(a, b, c, N, BLOCK_SIZE, threads);
+                           },
+                           threads});
+    }
+    return bench_matrix("matrix_multiply --multithread-test", N, seed, kernels, config);
+}
+
+// 解析 argv[first] 开始的可选 N 和 bench_harness 选项，失败时输出用法
+static bool parse_bench_args(int argc, char** argv, int first, int* N, BenchConfig* config) {
+    bench_config_init(config);
+    int i = first;
+    if (i < argc && argv[i][0] != '-') {
+        *N = std::atoi(argv[i]);
+        ++i;
+    }
+    if (*N <= 0) {
+        print_usage(argv[0]);
+        return false;
+    }
+    for (; i < argc; ++i) {
+        int used = bench_parse_option(config, argc, argv, i);
+        if (used <= 0) {
+            if (used == 0)
+                std::cerr << "Error: Unknown option '" << argv[i] << "'" << std::endl;
+            print_usage(argv[0]);
+            return false;
+        }
+        i += used - 1;
+    }
+    return true;
+}
+
 void run_with_best(int N = 4096, float seed = 0.12345f) { blocked_multiply_avx_mt(THREAD_NUM, N, seed); }
 
 void print_usage(const char* prog_name) {
     std::cerr << "Usage: " << prog_name << " [N] [seed]" << std::endl;
     std::cerr << "  Runs the best performing version (multithreaded AVX) with optional N and seed." << std::endl;
+    std::cerr << "  Prefix any command with --hugepages to allocate the matrices with huge pages." << std::endl;
     std::cerr << std::endl;
     std::cerr << "Or, run a specific test case:" << std::endl;
     std::cerr << "  " << prog_name << " --basic              - Runs the basic single-threaded matrix multiply test."
@@ -403,13 +708,33 @@ void print_usage(const char* prog_name) {
               << std::endl;
     std::cerr << "  " << prog_name << " --sse                 - Runs the single-threaded advanced SSE test."
               << std::endl;
-    std::cerr << "  " << prog_name << " --multithread-test    - Runs the multithreaded performance comparison."
+    std::cerr << "  " << prog_name
+              << " --multithread-test [N] [options] - Compares thread counts of multithreaded AVX (N=4096)."
+              << std::endl;
+    std::cerr << "  " << prog_name
+              << " --numa-compare [N]    - Compares NUMA-pinned and unpinned multithreaded AVX (5 runs each)."
+              << std::endl;
+    std::cerr << "  " << prog_name
+              << " --hugepage-compare [N] - Compares 4KB and huge-page matrices (time and dTLB load misses)."
+              << std::endl;
+    std::cerr << "  " << prog_name
+              << " --bench [N] [options] - Benchmarks every kernel with warmups and adaptive repetitions (N=1024)."
               << std::endl;
+    std::cerr << "Options for --bench and --multithread-test (e.g. --store bench_results.tsv, then bench_compare):"
+              << std::endl;
+    std::cerr << bench_usage();
     // std::cerr << "  " << prog_name << " --all                 - Runs all of the above tests." << std::endl;
     std::cerr << "  " << prog_name << " --help, -h            - Shows this help message." << std::endl;
 }
 
 int main(int argc, char** argv) {
+    // --hugepages 可以放在其他参数前面：之后的测试改用大页存储矩阵
+    if (argc > 1 && std::string(argv[1]) == "--hugepages") {
+        huge_pages_set_enabled(true);
+        argv[1] = argv[0];
+        ++argv;
+        --argc;
+    }
 
     // 情况1: 没有提供任何参数，运行最佳版本
     if (argc == 1) {
@@ -426,13 +751,29 @@ int main(int argc, char** argv) {
         } else if (arg1 == "--sse") {
             blocked_multiply_sse();
         } else if (arg1 == "--multithread-test") {
-            test_multithreaded_performance();
+            int n = 4096;
+            BenchConfig config;
+            if (!parse_bench_args(argc, argv, 2, &n, &config))
+                return 1;
+            return test_multithreaded_performance(n, 0.12345f, &config);
+        } else if (arg1 == "--numa-compare") {
+            test_numa_placement(argc >= 3 ? std::atoi(argv[2]) : 4096);
+        } else if (arg1 == "--hugepage-compare") {
+            test_huge_pages(argc >= 3 ? std::atoi(argv[2]) : 4096);
+        } else if (arg1 == "--bench") {
+            int n = 1024;
+            BenchConfig config;
+            if (!parse_bench_args(argc, argv, 2, &n, &config))
+                return 1;
+            return bench_matrix_kernels(n, 0.12345f, &config);
         } else if (arg1 == "--all") {
             std::cout << "--- Running Single-Threaded AVX Test ---" << std::endl;
             blocked_multiply_avx();
             std::cout << "\n--- Running Single-Threaded SSE Test ---" << std::endl;
             blocked_multiply_sse();
-            test_multithreaded_performance();
+            BenchConfig config;
+            bench_config_init(&config);
+            test_multithreaded_performance(4096, 0.12345f, &config);
         } else if (arg1 == "--help" || arg1 == "-h") {
             print_usage(argv[0]);
         } else if (arg1 == "--basic") {
@@ -0,0 +1,156 @@
+#include "numa_topology.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUMA_SYSFS_DIR "/sys/devices/system/node"
+
+static NumaPlacement placement_mode = NUMA_PLACEMENT_AUTO;
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+static NumaTopology cached_topology;
+
+// 读取 sysfs 中的一行列表文件（如 "0-3,8-11"）
+static bool read_list_file(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+    bool ok = fgets(buffer, (int)size, file) != NULL;
+    fclose(file);
+    return ok;
+}
+
+// 解析 "0-3,8-11" 形式的列表，对其中每个编号调用 visit，返回编号个数
+template <typename Visit> static int parse_list(const char* list, Visit visit) {
+    int count = 0;
+    const char* p = list;
+    while (*p && *p != '\n') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1)
+                break;
+            p = end;
+        }
+        for (long i = first; i <= last; i++, count++)
+            visit((int)i);
+        if (*p == ',')
+            p++;
+    }
+    return count;
+}
+
+int numa_topology_detect(NumaTopology* topo) {
+    memset(topo, 0, sizeof(NumaTopology));
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, &allowed);
+    }
+
+    char online[4096];
+    if (read_list_file(NUMA_SYSFS_DIR "/online", online, sizeof(online))) {
+        parse_list(online, [&](int id) {
+            if (topo->num_nodes >= NUMA_MAX_NODES)
+                return;
+            char path[128];
+            char cpulist[4096];
+            snprintf(path, sizeof(path), NUMA_SYSFS_DIR "/node%d/cpulist", id);
+            if (!read_list_file(path, cpulist, sizeof(cpulist)))
+                return;
+
+            NumaNode* node = &topo->nodes[topo->num_nodes];
+            node->id = id;
+            CPU_ZERO(&node->cpus);
+            parse_list(cpulist, [&](int cpu) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                    CPU_SET(cpu, &node->cpus);
+            });
+            node->num_cpus = CPU_COUNT(&node->cpus);
+            // 没有可用CPU的节点上放不了线程
+            if (node->num_cpus > 0)
+                topo->num_nodes++;
+        });
+    }
+
+    if (topo->num_nodes == 0) {
+        topo->num_nodes = 1;
+        topo->nodes[0].id = 0;
+        topo->nodes[0].cpus = allowed;
+        topo->nodes[0].num_cpus = CPU_COUNT(&allowed);
+    }
+    return topo->num_nodes;
+}
+
+static void detect_once() {
+    numa_topology_detect(&cached_topology);
+}
+
+void numa_set_placement(NumaPlacement mode) {
+    placement_mode = mode;
+}
+
+const NumaTopology* numa_placement() {
+    if (placement_mode == NUMA_PLACEMENT_OFF)
+        return NULL;
+    pthread_once(&topology_once, detect_once);
+    if (placement_mode == NUMA_PLACEMENT_AUTO && cached_topology.num_nodes < 2)
+        return NULL;
+    return &cached_topology;
+}
+
+int numa_worker_node(const NumaTopology* topo, int worker, int num_workers) {
+    if (topo->num_nodes <= 1 || num_workers <= 0)
+        return 0;
+    int total_cpus = 0;
+    for (int n = 0; n < topo->num_nodes; n++)
+        total_cpus += topo->nodes[n].num_cpus;
+
+    // 第 worker 个线程在全部CPU中的相对位置，落在哪个节点的CPU区间里就属于哪个节点
+    long position = (long)worker * total_cpus / num_workers;
+    for (int n = 0; n < topo->num_nodes; n++) {
+        if (position < topo->nodes[n].num_cpus)
+            return n;
+        position -= topo->nodes[n].num_cpus;
+    }
+    return topo->num_nodes - 1;
+}
+
+int numa_current_node() {
+    const NumaTopology* topo = numa_placement();
+    if (!topo)
+        return -1;
+    int cpu = sched_getcpu();
+    if (cpu < 0)
+        return -1;
+    for (int n = 0; n < topo->num_nodes; n++) {
+        if (CPU_ISSET(cpu, &topo->nodes[n].cpus))
+            return n;
+    }
+    return -1;
+}
+
+int numa_bind_node(int node) {
+    const NumaTopology* topo = numa_placement();
+    if (!topo || node < 0 || node >= topo->num_nodes)
+        return -1;
+    // 绑到节点而不是单个CPU：节点内的负载均衡仍交给内核
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &topo->nodes[node].cpus) != 0)
+        return -1;
+    return node;
+}
+
+int numa_bind_worker(int worker, int num_workers) {
+    const NumaTopology* topo = numa_placement();
+    if (!topo)
+        return -1;
+    return numa_bind_node(numa_worker_node(topo, worker, num_workers));
+}
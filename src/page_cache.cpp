@@ -0,0 +1,82 @@
+#include "page_cache.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RESIDENCY_CHUNK (1 << 30) // 每次映射 1GB 检查，避免超大文件一次映射占满地址空间
+
+double page_cache_residency(const char* filepath, uint64_t* resident_bytes, uint64_t* file_bytes) {
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat st;
+    if (fstat(handle, &st) < 0) {
+        close(handle);
+        return -1;
+    }
+    uint64_t file_size = st.st_size;
+    if (file_bytes)
+        *file_bytes = file_size;
+
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    unsigned char* vec = (unsigned char*)malloc(RESIDENCY_CHUNK / page_size);
+    if (!vec) {
+        close(handle);
+        return -1;
+    }
+
+    // 映射本身不会读入数据，mincore 只查询页缓存
+    uint64_t resident_pages = 0;
+    bool ok = true;
+    for (uint64_t offset = 0; offset < file_size && ok; offset += RESIDENCY_CHUNK) {
+        size_t length = file_size - offset < RESIDENCY_CHUNK ? (size_t)(file_size - offset) : RESIDENCY_CHUNK;
+        void* addr = mmap(NULL, length, PROT_READ, MAP_SHARED, handle, (off_t)offset);
+        if (addr == MAP_FAILED) {
+            ok = false;
+            break;
+        }
+        size_t num_pages = (length + page_size - 1) / page_size;
+        if (mincore(addr, length, vec) == 0) {
+            for (size_t i = 0; i < num_pages; i++)
+                resident_pages += vec[i] & 1;
+        } else {
+            ok = false;
+        }
+        munmap(addr, length);
+    }
+    free(vec);
+    close(handle);
+    if (!ok)
+        return -1;
+
+    uint64_t resident = resident_pages * page_size;
+    if (resident > file_size)
+        resident = file_size; // 最后一页不满
+    if (resident_bytes)
+        *resident_bytes = resident;
+    return file_size > 0 ? (double)resident / file_size : 1.0;
+}
+
+int page_cache_drop(const char* filepath) {
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    // 先把脏页写回，否则 DONTNEED 会跳过它们
+    fdatasync(handle);
+    int ret = posix_fadvise(handle, 0, 0, POSIX_FADV_DONTNEED);
+    close(handle);
+    return ret == 0 ? 0 : -1;
+}
+
+void page_cache_readahead(int handle, off_t offset, size_t size, off_t end) {
+    if (end >= 0) {
+        if (offset >= end)
+            return;
+        if ((off_t)size > end - offset)
+            size = end - offset;
+    }
+    posix_fadvise(handle, offset, size, POSIX_FADV_WILLNEED);
+}
@@ -0,0 +1,131 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char* name;
+} perf_events[PERF_NUM_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instr"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC-miss"},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+     "dTLB-miss"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "br-miss"},
+};
+
+int perf_counters_open(PerfCounters* counters) {
+    int available = 0;
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[e].type;
+        attr.config = perf_events[e].config;
+        attr.disabled = 1;
+        attr.inherit = 1; // 统计被测函数创建的工作线程
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counters->fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counters->fds[e] >= 0)
+            available++;
+    }
+    return available;
+}
+
+void perf_counters_start(PerfCounters* counters) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (counters->fds[e] < 0)
+            continue;
+        ioctl(counters->fds[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(PerfCounters* counters, PerfSample* sample) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        sample->valid[e] = false;
+        sample->value[e] = 0;
+        if (counters->fds[e] < 0)
+            continue;
+        ioctl(counters->fds[e], PERF_EVENT_IOC_DISABLE, 0);
+
+        // value, time_enabled, time_running
+        uint64_t data[3];
+        if (read(counters->fds[e], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0)
+            continue;
+        sample->valid[e] = true;
+        sample->value[e] = data[2] < data[1] ? (double)data[0] * data[1] / data[2] : (double)data[0];
+    }
+}
+
+void perf_counters_close(PerfCounters* counters) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        if (counters->fds[e] >= 0)
+            close(counters->fds[e]);
+        counters->fds[e] = -1;
+    }
+}
+
+double perf_sample_ipc(const PerfSample* sample) {
+    if (!sample->valid[PERF_EVENT_CYCLES] || !sample->valid[PERF_EVENT_INSTRUCTIONS] ||
+        sample->value[PERF_EVENT_CYCLES] <= 0)
+        return -1;
+    return sample->value[PERF_EVENT_INSTRUCTIONS] / sample->value[PERF_EVENT_CYCLES];
+}
+
+void perf_sample_clear(PerfSample* sum) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        sum->valid[e] = true;
+        sum->value[e] = 0;
+    }
+}
+
+void perf_sample_accumulate(PerfSample* sum, const PerfSample* sample, double weight) {
+    for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+        sum->valid[e] = sum->valid[e] && sample->valid[e];
+        sum->value[e] += sample->value[e] * weight;
+    }
+}
+
+// 按 K/M/G 缩写
+static int format_count(char* buffer, size_t size, double value) {
+    if (value >= 1e9)
+        return snprintf(buffer, size, "%.2fG", value / 1e9);
+    if (value >= 1e6)
+        return snprintf(buffer, size, "%.2fM", value / 1e6);
+    if (value >= 1e3)
+        return snprintf(buffer, size, "%.2fK", value / 1e3);
+    return snprintf(buffer, size, "%.0f", value);
+}
+
+void perf_sample_format(const PerfSample* sample, char* buffer, size_t size) {
+    size_t len = 0;
+    buffer[0] = '\0';
+    for (int e = 0; e < PERF_NUM_EVENTS && len < size; e++) {
+        len += snprintf(buffer + len, size - len, "%s%s ", e > 0 ? " " : "", perf_events[e].name);
+        if (len >= size)
+            break;
+        if (sample->valid[e])
+            len += format_count(buffer + len, size - len, sample->value[e]);
+        else
+            len += snprintf(buffer + len, size - len, "n/a");
+        // IPC 紧跟在 instructions 后面
+        if (e == PERF_EVENT_INSTRUCTIONS && len < size) {
+            double ipc = perf_sample_ipc(sample);
+            if (ipc >= 0)
+                len += snprintf(buffer + len, size - len, " IPC %.2f", ipc);
+            else
+                len += snprintf(buffer + len, size - len, " IPC n/a");
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#include "bench_filelines.h"
+
+#include "filelines_simd_opt.h"
+#include "page_cache.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+static void filelines_bench_setup(BenchCase* bc) {
+    FilelinesBenchCase* fc = (FilelinesBenchCase*)bc;
+    if (fc->cache == FILELINES_CACHE_COLD) {
+        if (page_cache_drop(fc->filepath) < 0)
+            fc->drop_failed = true;
+    } else if (fc->cache == FILELINES_CACHE_WARM && page_cache_residency(fc->filepath) < 1.0) {
+        // 冷缓存运行（或 O_DIRECT 版本）之后文件不一定完整缓存
+        uint32_t total = 0;
+        filelines_simd(fc->filepath, &total, fc->line_num);
+    }
+
+    double resident = page_cache_residency(fc->filepath);
+    if (resident >= 0) {
+        fc->resident_sum += resident;
+        fc->resident_runs++;
+    }
+    memset(fc->line_num, 0, sizeof(fc->line_num));
+    fc->total_lines = 0;
+}
+
+static void filelines_bench_run(BenchCase* bc) {
+    FilelinesBenchCase* fc = (FilelinesBenchCase*)bc;
+    fc->func(fc->filepath, &fc->total_lines, fc->line_num);
+    find_most_freq_line(fc->line_num, &fc->most_freq_len, &fc->most_freq_count);
+    bc->digest = ((uint64_t)fc->total_lines << 32) ^ ((uint64_t)fc->most_freq_len << 20) ^ fc->most_freq_count;
+}
+
+void filelines_bench_case_init(FilelinesBenchCase* fc, const char* name, char* filepath,
+                               void (*func)(char*, uint32_t*, uint32_t*), FilelinesCacheMode cache) {
+    struct stat st;
+    fc->base.name = name;
+    fc->base.setup = filelines_bench_setup;
+    fc->base.run = filelines_bench_run;
+    fc->base.work = stat(filepath, &st) == 0 ? st.st_size / (1024.0 * 1024.0) : 0;
+    fc->base.unit = "MB/s";
+    fc->base.digest = 0;
+    fc->filepath = filepath;
+    fc->func = func;
+    fc->cache = cache;
+    fc->total_lines = fc->most_freq_len = fc->most_freq_count = 0;
+    fc->resident_sum = 0;
+    fc->resident_runs = 0;
+    fc->drop_failed = false;
+}
+
+double filelines_bench_resident(const FilelinesBenchCase* fc) {
+    return fc->resident_runs > 0 ? fc->resident_sum / fc->resident_runs : 0;
+}
@@ -0,0 +1,170 @@
+#include "filelines_autotune.h"
+
+#include "filelines_mt.h"
+#include "find_most_freq.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define DEFAULT_QUEUE_SIZE 4
+
+static const uint32_t probe_block_sizes[] = {64 << 10, 256 << 10, 1 << 20, 4 << 20};
+static const uint32_t probe_queue_sizes[] = {2, 4, 8, 16};
+
+const char* autotune_cache_path() {
+    static char path[PATH_MAX];
+    const char* env = getenv(AUTOTUNE_CACHE_ENV);
+    if (env && *env)
+        return env;
+    const char* home = getenv("HOME");
+    snprintf(path, sizeof(path), "%s/.filelines_tune", home && *home ? home : ".");
+    return path;
+}
+
+// 文件所在设备和文件系统类型
+static bool device_key(const char* filepath, uint64_t* dev, uint64_t* fs_type) {
+    struct stat st;
+    struct statfs sfs;
+    if (stat(filepath, &st) < 0 || statfs(filepath, &sfs) < 0)
+        return false;
+    *dev = st.st_dev;
+    *fs_type = (uint64_t)sfs.f_type;
+    return true;
+}
+
+static std::vector<TuneConfig> load_cache() {
+    std::vector<TuneConfig> entries;
+    FILE* fp = fopen(autotune_cache_path(), "r");
+    if (!fp)
+        return entries;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        TuneConfig entry;
+        unsigned long long dev, fs_type;
+        if (line[0] == '#' ||
+            sscanf(line, "%llu %llx %u %u %lf", &dev, &fs_type, &entry.block_size, &entry.queue_size,
+                   &entry.throughput) != 5)
+            continue;
+        entry.dev = dev;
+        entry.fs_type = fs_type;
+        entries.push_back(entry);
+    }
+    fclose(fp);
+    return entries;
+}
+
+// 替换（或追加）本设备的条目，先写临时文件再 rename
+static void save_cache(const TuneConfig* config) {
+    std::vector<TuneConfig> entries = load_cache();
+    bool replaced = false;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].dev == config->dev && entries[i].fs_type == config->fs_type) {
+            entries[i] = *config;
+            replaced = true;
+        }
+    }
+    if (!replaced)
+        entries.push_back(*config);
+
+    std::string tmp_path = std::string(autotune_cache_path()) + ".tmp";
+    FILE* fp = fopen(tmp_path.c_str(), "w");
+    if (!fp)
+        return;
+    fprintf(fp, "# dev fs_type block_size queue_size throughput(MB/s)\n");
+    for (size_t i = 0; i < entries.size(); i++)
+        fprintf(fp, "%llu %llx %u %u %.1f\n", (unsigned long long)entries[i].dev,
+                (unsigned long long)entries[i].fs_type, entries[i].block_size, entries[i].queue_size,
+                entries[i].throughput);
+    bool ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), autotune_cache_path()) < 0)
+        unlink(tmp_path.c_str());
+}
+
+int autotune_lookup(const char* filepath, TuneConfig* config) {
+    uint64_t dev, fs_type;
+    if (!device_key(filepath, &dev, &fs_type))
+        return -1;
+    std::vector<TuneConfig> entries = load_cache();
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].dev == dev && entries[i].fs_type == fs_type) {
+            *config = entries[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// 冷读一次文件开头 probe_bytes 字节，返回吞吐量（MB/s）
+static double probe(char* filepath, int handle, uint64_t probe_bytes, uint32_t block_size, uint32_t queue_size) {
+    posix_fadvise(handle, 0, probe_bytes, POSIX_FADV_DONTNEED);
+
+    uint32_t line_num[MAX_LEN];
+    memset(line_num, 0, sizeof(line_num));
+    uint32_t total_line_num = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    filelines_mt_config(filepath, &total_line_num, line_num, block_size, queue_size, probe_bytes);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return seconds > 0 ? probe_bytes / (1024.0 * 1024.0) / seconds : 0;
+}
+
+int filelines_autotune(char* filepath, TuneConfig* config, uint64_t probe_bytes, bool verbose) {
+    memset(config, 0, sizeof(TuneConfig));
+    if (!device_key(filepath, &config->dev, &config->fs_type))
+        return -1;
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat st;
+    if (fstat(handle, &st) < 0 || st.st_size == 0) {
+        close(handle);
+        return -1;
+    }
+    if (probe_bytes == 0)
+        probe_bytes = AUTOTUNE_PROBE_BYTES;
+    if (probe_bytes > (uint64_t)st.st_size)
+        probe_bytes = st.st_size;
+
+    // 第一轮：默认队列大小下比较块大小
+    config->queue_size = DEFAULT_QUEUE_SIZE;
+    for (size_t i = 0; i < sizeof(probe_block_sizes) / sizeof(probe_block_sizes[0]); i++) {
+        double throughput = probe(filepath, handle, probe_bytes, probe_block_sizes[i], DEFAULT_QUEUE_SIZE);
+        if (verbose)
+            fprintf(stderr, "autotune: block %uKB queue %d: %.1f MB/s\n", probe_block_sizes[i] >> 10,
+                    DEFAULT_QUEUE_SIZE, throughput);
+        if (throughput > config->throughput) {
+            config->block_size = probe_block_sizes[i];
+            config->throughput = throughput;
+        }
+    }
+
+    // 第二轮：最佳块大小下比较队列大小（默认队列大小已经测过）
+    for (size_t i = 0; i < sizeof(probe_queue_sizes) / sizeof(probe_queue_sizes[0]); i++) {
+        if (probe_queue_sizes[i] == DEFAULT_QUEUE_SIZE)
+            continue;
+        double throughput = probe(filepath, handle, probe_bytes, config->block_size, probe_queue_sizes[i]);
+        if (verbose)
+            fprintf(stderr, "autotune: block %uKB queue %u: %.1f MB/s\n", config->block_size >> 10,
+                    probe_queue_sizes[i], throughput);
+        if (throughput > config->throughput) {
+            config->queue_size = probe_queue_sizes[i];
+            config->throughput = throughput;
+        }
+    }
+    close(handle);
+
+    save_cache(config);
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include "filelines_checkpoint.h"
+
+#include "direct_io.h"
+#include "range_scan.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE     (256 << 10) // 256KB
+#define MIN_RANGE_SIZE (4 << 20)   // 新增部分每个线程至少 4MB，几 MB 的增量直接在调用线程里扫完
+
+struct TailRange {
+    int handle;
+    off_t start;
+    off_t end;
+    RangeBoundary boundary;
+    LineHistogram hist;
+    bool ok; // 整个区间都扫描完
+};
+
+static void* tail_range_thread(void* arg) {
+    TailRange* range = (TailRange*)arg;
+    char* buffer = alloc_io_buffer(BLOCK_SIZE);
+    if (!buffer)
+        return NULL;
+    range->ok = scan_file_range(range->handle, range->start, range->end, buffer, BLOCK_SIZE, &range->boundary,
+                                &range->hist);
+    free(buffer);
+    return NULL;
+}
+
+// 扫描 [start, end)，行统计累加到 hist，*cur_len 输入输出跨 start/end 尚未结束的行长度
+// 内存分配、读取失败或文件变短时返回 false，hist 和 *cur_len 不完整，不能再作为检查点保存
+static bool scan_tail(int handle, off_t start, off_t end, uint64_t* cur_len, LineHistogram* hist, int num_threads) {
+    if (num_threads <= 0)
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    off_t max_threads = (end - start + MIN_RANGE_SIZE - 1) / MIN_RANGE_SIZE;
+    if (num_threads > max_threads)
+        num_threads = max_threads > 0 ? (int)max_threads : 1;
+
+    TailRange* ranges = (TailRange*)calloc(num_threads, sizeof(TailRange));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    RangeBoundary* boundaries = (RangeBoundary*)malloc(num_threads * sizeof(RangeBoundary));
+    if (!ranges || !threads || !boundaries) {
+        free(ranges);
+        free(threads);
+        free(boundaries);
+        return false;
+    }
+
+    off_t range_size = (end - start + num_threads - 1) / num_threads;
+    range_size = (range_size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    for (int t = 0; t < num_threads; t++) {
+        ranges[t].handle = handle;
+        ranges[t].start = start + t * range_size < end ? start + t * range_size : end;
+        ranges[t].end = start + (t + 1) * range_size < end ? start + (t + 1) * range_size : end;
+    }
+    // 只有一段时不创建线程
+    if (num_threads == 1) {
+        tail_range_thread(&ranges[0]);
+    } else {
+        for (int t = 0; t < num_threads; t++)
+            pthread_create(&threads[t], NULL, tail_range_thread, &ranges[t]);
+        for (int t = 0; t < num_threads; t++)
+            pthread_join(threads[t], NULL);
+    }
+
+    bool ok = true;
+    for (int t = 0; t < num_threads; t++) {
+        ok = ok && ranges[t].ok;
+        line_histogram_merge(hist, &ranges[t].hist);
+        boundaries[t] = ranges[t].boundary;
+    }
+    // 检查点中未结束的行接到新增部分的第一段上
+    *cur_len = stitch_ranges(boundaries, num_threads, hist, *cur_len);
+
+    free(ranges);
+    free(threads);
+    free(boundaries);
+    return ok;
+}
+
+// [offset - CHECKPOINT_HASH_SIZE, offset) 的 FNV-1a 哈希，读取失败返回0
+static uint64_t hash_before(int handle, uint64_t offset) {
+    char buffer[CHECKPOINT_HASH_SIZE];
+    size_t size = offset < CHECKPOINT_HASH_SIZE ? (size_t)offset : CHECKPOINT_HASH_SIZE;
+    ssize_t bytes_read = pread(handle, buffer, size, (off_t)(offset - size));
+    if (bytes_read != (ssize_t)size)
+        return 0;
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)buffer[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static bool load_checkpoint(const char* checkpoint_path, LineCheckpoint* checkpoint) {
+    int handle = open(checkpoint_path, O_RDONLY);
+    if (handle < 0)
+        return false;
+    ssize_t bytes_read = read(handle, checkpoint, sizeof(LineCheckpoint));
+    close(handle);
+
+    return bytes_read == (ssize_t)sizeof(LineCheckpoint) && memcmp(checkpoint->magic, CHECKPOINT_MAGIC, 8) == 0 &&
+           checkpoint->version == CHECKPOINT_VERSION && checkpoint->struct_size == sizeof(LineCheckpoint);
+}
+
+static void save_checkpoint(const char* checkpoint_path, const LineCheckpoint* checkpoint) {
+    // 先写临时文件并落盘，再原子替换
+    std::string tmp_path = std::string(checkpoint_path) + ".tmp";
+    int handle = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (handle < 0)
+        return;
+    bool ok = write(handle, checkpoint, sizeof(LineCheckpoint)) == (ssize_t)sizeof(LineCheckpoint);
+    ok = fsync(handle) == 0 && ok;
+    close(handle);
+    if (!ok || rename(tmp_path.c_str(), checkpoint_path) < 0)
+        unlink(tmp_path.c_str());
+}
+
+int filelines_incremental(const char* filepath, const char* checkpoint_path, LineHistogram* hist, int num_threads,
+                          uint64_t* scanned_bytes) {
+    line_histogram_init(hist);
+    if (scanned_bytes)
+        *scanned_bytes = 0;
+
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat st;
+    if (fstat(handle, &st) < 0) {
+        close(handle);
+        return -1;
+    }
+    uint64_t file_size = (uint64_t)st.st_size;
+
+    LineCheckpoint* checkpoint = (LineCheckpoint*)malloc(sizeof(LineCheckpoint));
+    if (!checkpoint) {
+        close(handle);
+        return -1;
+    }
+
+    bool resumed = false;
+    if (load_checkpoint(checkpoint_path, checkpoint) && checkpoint->dev == (uint64_t)st.st_dev &&
+        checkpoint->ino == (uint64_t)st.st_ino && checkpoint->offset <= file_size) {
+        bool unchanged = checkpoint->offset == file_size && checkpoint->mtime_sec == (int64_t)st.st_mtim.tv_sec &&
+                         checkpoint->mtime_nsec == (int64_t)st.st_mtim.tv_nsec;
+        // 大小和修改时间都没变时不需要读文件；否则确认已扫描部分的末尾没有被改写
+        resumed = unchanged || checkpoint->tail_hash == hash_before(handle, checkpoint->offset);
+    }
+    if (!resumed) {
+        line_histogram_init(&checkpoint->hist);
+        checkpoint->offset = 0;
+        checkpoint->cur_len = 0;
+    }
+
+    if (file_size > checkpoint->offset) {
+        posix_fadvise(handle, checkpoint->offset, file_size - checkpoint->offset, POSIX_FADV_SEQUENTIAL);
+        // 新增部分没有完整扫描时直方图缺了一段，不能保存成检查点，保留磁盘上原来的检查点
+        if (!scan_tail(handle, checkpoint->offset, file_size, &checkpoint->cur_len, &checkpoint->hist,
+                       num_threads)) {
+            free(checkpoint);
+            close(handle);
+            return -1;
+        }
+        if (scanned_bytes)
+            *scanned_bytes = file_size - checkpoint->offset;
+        checkpoint->offset = file_size;
+        checkpoint->tail_hash = hash_before(handle, file_size);
+    }
+
+    memcpy(checkpoint->magic, CHECKPOINT_MAGIC, 8);
+    checkpoint->version = CHECKPOINT_VERSION;
+    checkpoint->struct_size = sizeof(LineCheckpoint);
+    checkpoint->dev = st.st_dev;
+    checkpoint->ino = st.st_ino;
+    checkpoint->mtime_sec = st.st_mtim.tv_sec;
+    checkpoint->mtime_nsec = st.st_mtim.tv_nsec;
+    if (!resumed && file_size == 0)
+        checkpoint->tail_hash = hash_before(handle, 0);
+    // 检查点写入失败不影响本次结果，下次会从头扫描
+    save_checkpoint(checkpoint_path, checkpoint);
+
+    memcpy(hist, &checkpoint->hist, sizeof(LineHistogram));
+    free(checkpoint);
+    close(handle);
+    return resumed ? 1 : 0;
+}
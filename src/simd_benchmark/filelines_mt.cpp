@@ -1,207 +1,215 @@
 #include "filelines_mt.h"
 
+#include "direct_io.h"
 #include "find_most_freq.h"
-
+#include "huge_pages.h"
+#include "numa_topology.h"
+#include "page_cache.h"
+#include "range_scan.h"
+#include "simd_kernel.h"
+#include "uring_reader.h"
+
+#include <atomic>
+#include <errno.h>
 #include <fcntl.h>
-#include <immintrin.h>
+#include <linux/futex.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
-#define BLOCK_SIZE        256 << 10 // 256KB
-#define BUFFER_QUEUE_SIZE 4         // 缓冲队列大小
+#define BLOCK_SIZE        (256 << 10) // 256KB
+#define BUFFER_QUEUE_SIZE 4           // 缓冲队列默认大小
+#define MAX_QUEUE_SIZE    64          // 可配置的最大队列大小
+#define MIN_RANGE_SIZE    (4 << 20)   // 分段模式下每个线程至少负责 4MB，避免小文件开太多线程
+#define URING_QUEUE_DEPTH 32          // io_uring 模式默认同时在途的读请求数
 
-// 数据块结构
+// 数据块结构：每个队列槽位固定拥有一块预分配的缓冲区，循环复用
 struct DataBlock {
     char* data;
     ssize_t size;
-    bool valid;
 };
 
-// 生产者-消费者共享数据结构
+// 阻塞等待点：先自旋，条件仍不满足时才通过 futex 睡眠
+// 每个等待点只有一个等待者（单生产者/单消费者）
+struct WaitPoint {
+    std::atomic<uint32_t> events;  // futex 字，每次唤醒前加一，防止丢失唤醒
+    std::atomic<uint32_t> waiting; // 等待者是否可能已经（或即将）进入睡眠
+};
+
+#define SPIN_COUNT 256 // 进入 futex 睡眠前的自旋次数
+
+static inline void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void futex_wake(std::atomic<uint32_t>* addr) {
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// 通知对端：只有对端可能在睡眠时才需要系统调用
+static inline void wait_point_notify(WaitPoint* point) {
+    if (point->waiting.load()) {
+        point->events.fetch_add(1);
+        futex_wake(&point->events);
+    }
+}
+
+template <typename Ready> static inline void wait_point_wait(WaitPoint* point, Ready ready) {
+    for (int i = 0; i < SPIN_COUNT; i++) {
+        if (ready())
+            return;
+        __builtin_ia32_pause();
+    }
+    while (1) {
+        // 先声明要睡眠、记下事件号，再复查条件；之后对端的任何通知都会改变事件号，futex_wait 不会睡死
+        point->waiting.store(1);
+        uint32_t events = point->events.load();
+        if (ready())
+            break;
+        futex_wait(&point->events, events);
+    }
+    point->waiting.store(0);
+}
+
+// 生产者-消费者共享数据结构：无锁单生产者/单消费者环形队列
+// write_pos / read_pos 只增不减，取模得到槽位；分别只由生产者 / 消费者写入，放在不同缓存行避免伪共享
 struct SharedData {
-    DataBlock queue[BUFFER_QUEUE_SIZE];
-    int write_pos;
-    int read_pos;
-    int count;
-    bool producer_done;
+    DataBlock queue[MAX_QUEUE_SIZE];
+    uint32_t queue_size;
+    size_t block_size;
+    uint64_t max_bytes; // 只读取文件开头的这么多字节，0 表示整个文件
+    char* pool;         // 所有槽位缓冲区的一次性分配
 
-    pthread_mutex_t mutex;
-    pthread_cond_t not_empty;
-    pthread_cond_t not_full;
+    alignas(64) std::atomic<uint32_t> write_pos;
+    std::atomic<bool> producer_done;
+    WaitPoint not_empty; // 消费者在这里等数据
+
+    alignas(64) std::atomic<uint32_t> read_pos;
+    WaitPoint not_full; // 生产者在这里等空槽位
 
     // 统计数据
-    uint32_t* total_line_num;
+    alignas(64) uint32_t* total_line_num;
     uint32_t* line_num;
     int cur_len;
 
     // 文件路径
     char* filepath;
+    bool direct_io;
+    int numa_node; // 生产者和消费者共同绑定的节点下标，-1 表示不绑核
 };
 
-// SIMD处理函数 (使用 SSE 替代 AVX2，因为 AVX 不支持 256 位整数运算)
-static inline void
-process_block_simd_opt(const char* buffer, ssize_t size, uint32_t* total_line_num, uint32_t* line_num, int* cur_len) {
-    ssize_t i = 0;
-    const __m128i newline = _mm_set1_epi8('\n');
-
-    // SIMD处理：每次处理16字节 (SSE)
-    while (i + 16 <= size) {
-        __m128i chunk = _mm_loadu_si128((__m128i*)(buffer + i));
-        __m128i cmp = _mm_cmpeq_epi8(chunk, newline);
-        uint32_t mask = _mm_movemask_epi8(cmp);
-
-        i += 16;
-        if (__builtin_expect(mask == 0, 0)) {
-            *cur_len += 16;
-        } else {
-            int newlines_in_chunk = __builtin_popcount(mask);
-            *total_line_num += newlines_in_chunk;
-            int last_pos = -1;
-            while (mask != 0) {
-                int pos = __builtin_ctz(mask);
-                int line_length = *cur_len + (pos - last_pos - 1);
-                if (line_length < MAX_LEN) {
-                    ++line_num[line_length];
-                } else {
-                    ++line_num[MAX_LEN - 1];
-                }
-                *cur_len = 0;
-                last_pos = pos;
-                // 高效清除这个已经处理过的 '1'
-                mask &= (mask - 1);
-            }
-            *cur_len = 15 - last_pos;
-        }
-    }
-    while (i < size) {
-        if (buffer[i] == '\n') {
-            ++(*total_line_num);
-            if (*cur_len >= MAX_LEN)
-                ++line_num[MAX_LEN - 1];
-            else
-                ++line_num[*cur_len];
-            *cur_len = 0;
-        } else {
-            ++(*cur_len);
-        }
-        ++i;
-    }
-}
-
 // 生产者线程：读取文件块
 void* producer_thread(void* arg) {
     SharedData* shared = (SharedData*)arg;
     char* filepath = shared->filepath;
-
-    int handle = open(filepath, O_RDONLY);
-    if (handle < 0) {
-        pthread_mutex_lock(&shared->mutex);
-        shared->producer_done = true;
-        pthread_cond_signal(&shared->not_empty);
-        pthread_mutex_unlock(&shared->mutex);
-        return NULL;
-    }
-
-    while (1) {
-        // 分配缓冲区 (16字节对齐用于SSE)
-        char* buffer = (char*)aligned_alloc(16, BLOCK_SIZE);
-        if (!buffer)
-            break;
-
-        // 读取数据
-        ssize_t bytes_read = read(handle, buffer, BLOCK_SIZE);
-        if (bytes_read <= 0) {
-            free(buffer);
-            break;
-        }
-
-        // 等待队列有空间
-        pthread_mutex_lock(&shared->mutex);
-        while (shared->count >= BUFFER_QUEUE_SIZE) {
-            pthread_cond_wait(&shared->not_full, &shared->mutex);
+    // 生产者和消费者绑在同一节点上，缓冲池由生产者首次写入，两边都是本地访问
+    numa_bind_node(shared->numa_node);
+
+    int handle = open_for_scan(filepath, shared->direct_io);
+    if (handle >= 0) {
+        uint32_t queue_size = shared->queue_size;
+        uint64_t remaining = shared->max_bytes > 0 ? shared->max_bytes : UINT64_MAX;
+        // 不是 O_DIRECT 时（包括 O_DIRECT 打开失败退回的情况）沿途提示预读
+        int flags = fcntl(handle, F_GETFL);
+        bool readahead = flags >= 0 && !(flags & O_DIRECT);
+        off_t offset = 0;
+        if (readahead)
+            page_cache_readahead(handle, 0, READAHEAD_DISTANCE);
+        uint32_t write_pos = shared->write_pos.load(std::memory_order_relaxed);
+        while (remaining > 0) {
+            // 等待队列有空槽位
+            wait_point_wait(&shared->not_full, [&] { return write_pos - shared->read_pos.load() < queue_size; });
+
+            // 直接读到槽位自带的缓冲区里，不再每块 malloc/free
+            DataBlock* block = &shared->queue[write_pos % queue_size];
+            ssize_t bytes_read = read_for_scan(handle, block->data, shared->block_size);
+            if (bytes_read <= 0)
+                break;
+            if (readahead)
+                page_cache_readahead(handle, offset + READAHEAD_DISTANCE, bytes_read);
+            offset += bytes_read;
+            // 限制读取量时，最后一块可能超出上限（O_DIRECT 只能按整块读），多出的部分不统计
+            if ((uint64_t)bytes_read > remaining)
+                bytes_read = (ssize_t)remaining;
+            remaining -= bytes_read;
+            block->size = bytes_read;
+
+            // 发布数据块
+            shared->write_pos.store(++write_pos);
+            wait_point_notify(&shared->not_empty);
         }
-
-        // 将数据块放入队列
-        shared->queue[shared->write_pos].data = buffer;
-        shared->queue[shared->write_pos].size = bytes_read;
-        shared->queue[shared->write_pos].valid = true;
-
-        shared->write_pos = (shared->write_pos + 1) % BUFFER_QUEUE_SIZE;
-        shared->count++;
-
-        pthread_cond_signal(&shared->not_empty);
-        pthread_mutex_unlock(&shared->mutex);
+        close(handle);
     }
 
     // 标记生产者完成
-    pthread_mutex_lock(&shared->mutex);
-    shared->producer_done = true;
-    pthread_cond_signal(&shared->not_empty);
-    pthread_mutex_unlock(&shared->mutex);
-
-    close(handle);
+    shared->producer_done.store(true);
+    wait_point_notify(&shared->not_empty);
     return NULL;
 }
 
 // 消费者线程：SIMD统计
 void* consumer_thread(void* arg) {
     SharedData* shared = (SharedData*)arg;
+    numa_bind_node(shared->numa_node);
 
+    uint32_t read_pos = shared->read_pos.load(std::memory_order_relaxed);
     while (1) {
-        pthread_mutex_lock(&shared->mutex);
-
         // 等待数据可用或生产者完成
-        while (shared->count == 0 && !shared->producer_done) {
-            pthread_cond_wait(&shared->not_empty, &shared->mutex);
-        }
-
-        // 检查是否已完成
-        if (shared->count == 0 && shared->producer_done) {
-            pthread_mutex_unlock(&shared->mutex);
+        bool has_data = false;
+        wait_point_wait(&shared->not_empty, [&] {
+            has_data = shared->write_pos.load() != read_pos;
+            return has_data || shared->producer_done.load();
+        });
+        // 生产者完成后队列里可能还有数据，再检查一次
+        if (!has_data && shared->write_pos.load() == read_pos)
             break;
-        }
-
-        // 从队列取出数据块
-        DataBlock block = shared->queue[shared->read_pos];
-        shared->queue[shared->read_pos].valid = false;
-        shared->read_pos = (shared->read_pos + 1) % BUFFER_QUEUE_SIZE;
-        shared->count--;
-
-        pthread_cond_signal(&shared->not_full);
-        pthread_mutex_unlock(&shared->mutex);
 
-        // 处理数据块（不需要持有锁）
-        process_block_simd_opt(block.data, block.size, shared->total_line_num, shared->line_num, &shared->cur_len);
+        // 原地处理数据块，处理完再把槽位还给生产者
+        DataBlock* block = &shared->queue[read_pos % shared->queue_size];
+        process_block_simd_opt(block->data, block->size, shared->total_line_num, shared->line_num, &shared->cur_len);
 
-        // 释放缓冲区
-        free(block.data);
+        shared->read_pos.store(++read_pos);
+        wait_point_notify(&shared->not_full);
     }
 
     return NULL;
 }
 
-void filelines_mt(char* filepath, uint32_t* total_line_num, uint32_t* line_num) {
+static void run_producer_consumer(char* filepath, uint32_t* total_line_num, uint32_t* line_num, bool direct_io,
+                                  size_t block_size = BLOCK_SIZE, int queue_size = BUFFER_QUEUE_SIZE,
+                                  uint64_t max_bytes = 0) {
     // 初始化共享数据
     SharedData shared;
-    memset(&shared, 0, sizeof(SharedData));
+    memset((void*)&shared, 0, sizeof(SharedData));
 
     shared.filepath = filepath;
+    shared.direct_io = direct_io;
+    shared.block_size = block_size;
+    shared.queue_size = queue_size;
+    shared.max_bytes = max_bytes;
+    // 留在启动时所在的节点，而不是固定绑到 0 号节点
+    shared.numa_node = numa_current_node();
     shared.total_line_num = total_line_num;
     shared.line_num = line_num;
     shared.cur_len = 0;
-    shared.producer_done = false;
-    shared.write_pos = 0;
-    shared.read_pos = 0;
-    shared.count = 0;
-
-    pthread_mutex_init(&shared.mutex, NULL);
-    pthread_cond_init(&shared.not_empty, NULL);
-    pthread_cond_init(&shared.not_full, NULL);
+    shared.producer_done.store(false);
+    shared.write_pos.store(0);
+    shared.read_pos.store(0);
+
+    // 预分配缓冲池 (按4KB对齐，同时满足SIMD和O_DIRECT的要求；打开大页时按2MB对齐)
+    size_t pool_size = (size_t)queue_size * block_size;
+    bool huge = huge_pages_enabled();
+    shared.pool = huge ? (char*)huge_alloc(pool_size) : alloc_io_buffer(pool_size);
+    if (!shared.pool)
+        return;
+    for (int i = 0; i < queue_size; i++)
+        shared.queue[i].data = shared.pool + (size_t)i * block_size;
 
     // 创建线程
     pthread_t producer, consumer;
@@ -214,7 +222,331 @@ void filelines_mt(char* filepath, uint32_t* total_line_num, uint32_t* line_num)
     pthread_join(consumer, NULL);
 
     // 清理
-    pthread_mutex_destroy(&shared.mutex);
-    pthread_cond_destroy(&shared.not_empty);
-    pthread_cond_destroy(&shared.not_full);
+    if (huge)
+        huge_free(shared.pool, pool_size);
+    else
+        free(shared.pool);
+}
+
+void filelines_mt(char* filepath, uint32_t* total_line_num, uint32_t* line_num) {
+    run_producer_consumer(filepath, total_line_num, line_num, false);
+}
+
+void filelines_mt_direct(char* filepath, uint32_t* total_line_num, uint32_t* line_num) {
+    run_producer_consumer(filepath, total_line_num, line_num, true);
+}
+
+void filelines_mt_config(char* filepath, uint32_t* total_line_num, uint32_t* line_num, size_t block_size,
+                         int queue_size, uint64_t max_bytes, bool direct_io) {
+    if (block_size == 0)
+        block_size = BLOCK_SIZE;
+    // 块大小按4KB取整，同时满足 O_DIRECT 和SIMD对齐
+    block_size = (block_size + DIRECT_IO_ALIGN - 1) / DIRECT_IO_ALIGN * DIRECT_IO_ALIGN;
+    if (queue_size <= 0)
+        queue_size = BUFFER_QUEUE_SIZE;
+    if (queue_size > MAX_QUEUE_SIZE)
+        queue_size = MAX_QUEUE_SIZE;
+    run_producer_consumer(filepath, total_line_num, line_num, direct_io, block_size, queue_size, max_bytes);
+}
+
+// 分段扫描结果：每个线程负责文件的一个字节区间 [start, end)
+struct RangeResult {
+    int handle;
+    const char* mapped; // 非空时直接扫描映射内存，不再 pread
+    off_t start;
+    off_t end;
+    int worker; // 线程编号，用于 NUMA 绑核
+    int num_workers;
+
+    RangeBoundary boundary;
+    // 区间内完整行的统计（不含开头那一行），使用64位计数避免超大文件溢出
+    LineHistogram hist;
+    bool ok; // 整个区间都扫描完（缓冲区分配失败、读取出错或文件被截断时为 false）
+};
+
+// 分段线程：用 pread 独立读取自己的区间（或直接使用映射内存）并做SIMD统计
+void* range_thread(void* arg) {
+    RangeResult* range = (RangeResult*)arg;
+
+    // 先绑核再分配：读缓冲区和统计表由本线程首次写入，落在本节点的内存上
+    LineHistogram* hist = &range->hist;
+    if (numa_bind_worker(range->worker, range->num_workers) >= 0) {
+        LineHistogram* local_hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+        if (local_hist) {
+            line_histogram_init(local_hist);
+            hist = local_hist;
+        }
+    }
+
+    if (range->mapped) {
+        uint64_t cur_len = 0;
+        scan_range_data(&range->boundary, range->mapped + range->start, range->end - range->start, hist, &cur_len);
+        range->boundary.tail_len = cur_len;
+        range->ok = true;
+    } else {
+        bool huge = huge_pages_enabled();
+        char* buffer = huge ? (char*)huge_alloc(BLOCK_SIZE) : alloc_io_buffer(BLOCK_SIZE);
+        if (buffer) {
+            range->ok =
+                scan_file_range(range->handle, range->start, range->end, buffer, BLOCK_SIZE, &range->boundary, hist);
+            if (huge)
+                huge_free(buffer, BLOCK_SIZE);
+            else
+                free(buffer);
+        }
+    }
+
+    if (hist != &range->hist) {
+        line_histogram_merge(&range->hist, hist);
+        free(hist);
+    }
+    return NULL;
+}
+
+bool filelines_mt_split_wide(char* filepath, LineHistogram* hist, int num_threads, bool use_mmap, bool direct_io) {
+    int handle = open_for_scan(filepath, direct_io);
+    if (handle < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(handle, &st) < 0) {
+        close(handle);
+        return false;
+    }
+    off_t file_size = st.st_size;
+
+    const char* mapped = NULL;
+    // mmap 总是经过页缓存，和 O_DIRECT 互斥
+    if (use_mmap && !direct_io && file_size > 0) {
+        void* addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, handle, 0);
+        if (addr != MAP_FAILED) {
+            mapped = (const char*)addr;
+            // 每个线程在自己的区间内顺序访问
+            madvise(addr, file_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            madvise(addr, file_size, MADV_HUGEPAGE);
+#endif
+        }
+    }
+
+    if (num_threads <= 0)
+        num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    // 文件太小时减少线程数
+    off_t max_threads = (file_size + MIN_RANGE_SIZE - 1) / MIN_RANGE_SIZE;
+    if (num_threads > max_threads)
+        num_threads = max_threads > 0 ? (int)max_threads : 1;
+
+    // 每段按块大小对齐，保证除最后一段外都是整块读取
+    off_t range_size = (file_size + num_threads - 1) / num_threads;
+    range_size = (range_size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+
+    RangeResult* ranges = (RangeResult*)calloc(num_threads, sizeof(RangeResult));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    RangeBoundary* boundaries = (RangeBoundary*)malloc(num_threads * sizeof(RangeBoundary));
+    if (!ranges || !threads || !boundaries) {
+        free(ranges);
+        free(threads);
+        free(boundaries);
+        if (mapped)
+            munmap((void*)mapped, file_size);
+        close(handle);
+        return false;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        ranges[t].handle = handle;
+        ranges[t].mapped = mapped;
+        ranges[t].start = t * range_size < file_size ? t * range_size : file_size;
+        ranges[t].end = (t + 1) * range_size < file_size ? (t + 1) * range_size : file_size;
+        ranges[t].worker = t;
+        ranges[t].num_workers = num_threads;
+        pthread_create(&threads[t], NULL, range_thread, &ranges[t]);
+    }
+    for (int t = 0; t < num_threads; t++)
+        pthread_join(threads[t], NULL);
+
+    // 有一段没有扫描完时整个结果作废，不把部分统计合并到 hist
+    bool ok = true;
+    for (int t = 0; t < num_threads; t++)
+        ok = ok && ranges[t].ok;
+    // 按文件顺序合并，把每段开头的半行和上一段结尾的半行拼起来
+    if (ok) {
+        for (int t = 0; t < num_threads; t++) {
+            line_histogram_merge(hist, &ranges[t].hist);
+            boundaries[t] = ranges[t].boundary;
+        }
+        stitch_ranges(boundaries, num_threads, hist);
+    }
+
+    free(boundaries);
+    free(threads);
+    free(ranges);
+    if (mapped)
+        munmap((void*)mapped, file_size);
+    close(handle);
+    return ok;
+}
+
+bool filelines_mt_split(
+    char* filepath, uint32_t* total_line_num, uint32_t* line_num, int num_threads, bool use_mmap, bool direct_io) {
+    LineHistogram* hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+    if (!hist)
+        return false;
+    line_histogram_init(hist);
+    bool ok = filelines_mt_split_wide(filepath, hist, num_threads, use_mmap, direct_io);
+    if (ok)
+        line_histogram_to_legacy(hist, total_line_num, line_num);
+    free(hist);
+    return ok;
+}
+
+// io_uring 读取槽位：每个槽位固定绑定一块注册缓冲区，文件第 k 块总是落在第 k % queue_depth 个槽位
+struct UringSlot {
+    char* data;
+    off_t offset;    // 该块在文件中的偏移
+    unsigned len;    // 该块需要读取的字节数
+    unsigned filled; // 已经读到的字节数（短读时继续补读）
+    bool done;
+};
+
+// 为槽位中尚未读到的部分填写读请求
+static inline bool uring_queue_slot(UringReader* reader, int handle, UringSlot* slot, int index) {
+    return uring_reader_prep_read(
+        reader, handle, slot->data + slot->filled, slot->len - slot->filled, slot->offset + slot->filled, index, index);
+}
+
+void filelines_mt_uring(char* filepath, uint32_t* total_line_num, uint32_t* line_num, int queue_depth) {
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return;
+
+    struct stat st;
+    if (fstat(handle, &st) < 0 || st.st_size == 0) {
+        close(handle);
+        return;
+    }
+    off_t file_size = st.st_size;
+    off_t num_blocks = (file_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    if (queue_depth <= 0)
+        queue_depth = URING_QUEUE_DEPTH;
+    if (queue_depth > num_blocks)
+        queue_depth = (int)num_blocks;
+
+    UringReader reader;
+    if (uring_reader_init(&reader, queue_depth) < 0) {
+        // 内核不支持（或禁止）io_uring 时退回生产者-消费者版本
+        close(handle);
+        filelines_mt(filepath, total_line_num, line_num);
+        return;
+    }
+
+    char* buffers = (char*)aligned_alloc(4096, (size_t)queue_depth * BLOCK_SIZE);
+    UringSlot* slots = (UringSlot*)calloc(queue_depth, sizeof(UringSlot));
+    struct iovec* iovecs = (struct iovec*)malloc(queue_depth * sizeof(struct iovec));
+    if (!buffers || !slots || !iovecs) {
+        free(buffers);
+        free(slots);
+        free(iovecs);
+        uring_reader_destroy(&reader);
+        close(handle);
+        filelines_mt(filepath, total_line_num, line_num);
+        return;
+    }
+
+    for (int s = 0; s < queue_depth; s++) {
+        slots[s].data = buffers + (size_t)s * BLOCK_SIZE;
+        iovecs[s].iov_base = slots[s].data;
+        iovecs[s].iov_len = BLOCK_SIZE;
+    }
+    // 注册固定缓冲区失败（例如 RLIMIT_MEMLOCK 太小）时仍可用普通 READ
+    uring_reader_register_buffers(&reader, iovecs, queue_depth);
+    free(iovecs);
+
+    // 先把队列填满，让设备上始终有 queue_depth 个请求在途
+    int inflight = 0;
+    for (int s = 0; s < queue_depth; s++) {
+        UringSlot* slot = &slots[s];
+        slot->offset = (off_t)s * BLOCK_SIZE;
+        slot->len = file_size - slot->offset < BLOCK_SIZE ? file_size - slot->offset : BLOCK_SIZE;
+        if (uring_queue_slot(&reader, handle, slot, s))
+            inflight++;
+    }
+
+    // 完成事件是乱序到达的，这里按文件顺序逐块等待并交给SIMD统计
+    // 先统计到局部数组，全部读完才累加到输出，出错时不会留下部分结果
+    uint32_t uring_total = 0;
+    uint32_t uring_line_num[MAX_LEN];
+    memset(uring_line_num, 0, sizeof(uring_line_num));
+    int cur_len = 0;
+    bool failed = false;
+    for (off_t block = 0; block < num_blocks && !failed; block++) {
+        int index = (int)(block % queue_depth);
+        UringSlot* slot = &slots[index];
+
+        while (!slot->done && !failed) {
+            if (uring_reader_submit(&reader, 1) < 0) {
+                failed = true;
+                break;
+            }
+            uint64_t user_data;
+            int res;
+            while (uring_reader_pop(&reader, &user_data, &res)) {
+                inflight--;
+                UringSlot* completed = &slots[user_data];
+                if (res == -EINTR || res == -EAGAIN) {
+                    // 可重试的错误：原样再提交一次
+                } else if (res < 0) {
+                    failed = true;
+                    continue;
+                } else {
+                    completed->filled += res;
+                    // res == 0 说明文件在扫描过程中被截断，按已读到的数据处理
+                    if (res == 0 || completed->filled == completed->len) {
+                        completed->done = true;
+                        continue;
+                    }
+                }
+                if (uring_queue_slot(&reader, handle, completed, (int)user_data))
+                    inflight++;
+            }
+        }
+        if (failed)
+            break;
+
+        process_block_simd_opt(slot->data, slot->filled, &uring_total, uring_line_num, &cur_len);
+
+        // 槽位空出来后立即用于读取后面第 queue_depth 块
+        off_t next_block = block + queue_depth;
+        slot->done = false;
+        slot->filled = 0;
+        if (next_block < num_blocks) {
+            slot->offset = next_block * BLOCK_SIZE;
+            slot->len = file_size - slot->offset < BLOCK_SIZE ? file_size - slot->offset : BLOCK_SIZE;
+            if (uring_queue_slot(&reader, handle, slot, index))
+                inflight++;
+        }
+    }
+
+    // 出错提前退出时，必须等在途请求全部完成后才能释放缓冲区
+    while (inflight > 0 && uring_reader_submit(&reader, 1) == 0) {
+        uint64_t user_data;
+        int res;
+        while (uring_reader_pop(&reader, &user_data, &res))
+            inflight--;
+    }
+
+    uring_reader_destroy(&reader);
+    free(slots);
+    free(buffers);
+    close(handle);
+
+    if (failed) {
+        // 提交失败或读取出错：丢弃这次的统计，整个文件用 filelines_mt 重新扫描
+        filelines_mt(filepath, total_line_num, line_num);
+        return;
+    }
+    *total_line_num += uring_total;
+    for (int i = 0; i < MAX_LEN; i++)
+        line_num[i] += uring_line_num[i];
 }
@@ -0,0 +1,165 @@
+#include "filelines_sample.h"
+
+#include "filelines_simd_opt.h"
+#include "simd_kernel.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE      (256 << 10) // 256KB
+#define NEWLINE_PROBE   4096        // 找行边界时每次只读 4KB，避免为一个换行符读一整块
+#define CONFIDENCE_Z    1.96        // 95% 置信区间
+
+// splitmix64：固定种子下结果可复现
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// 从 pos 开始找第一个换行符，返回它的偏移；到文件末尾都没有返回 -1
+static off_t next_newline(int handle, off_t pos, off_t file_size, char* buffer, uint64_t* bytes_read_total) {
+    while (pos < file_size) {
+        ssize_t bytes_read = pread(handle, buffer, NEWLINE_PROBE, pos);
+        if (bytes_read <= 0)
+            return -1;
+        *bytes_read_total += bytes_read;
+        const char* newline = (const char*)memchr(buffer, '\n', bytes_read);
+        if (newline)
+            return pos + (newline - buffer);
+        pos += bytes_read;
+    }
+    return -1;
+}
+
+// 统计起点落在 [start, end) 内的完整行，结果累加到 total_line_num / line_num
+static void sample_chunk(int handle, off_t start, off_t end, off_t file_size, char* buffer, uint32_t* total_line_num,
+                         uint32_t* line_num, uint64_t* bytes_read_total) {
+    // 第一个行首：start - 1 处是换行符时 start 本身就是行首
+    off_t first = 0;
+    if (start > 0) {
+        off_t newline = next_newline(handle, start - 1, file_size, buffer, bytes_read_total);
+        if (newline < 0)
+            return;
+        first = newline + 1;
+    }
+    if (first >= end)
+        return; // 整个块都在一个长行的中间
+
+    // 块内最后一行一直统计到它的换行符；没有换行符的文件末尾不是完整行，内核本来就不计入
+    off_t last = next_newline(handle, end - 1, file_size, buffer, bytes_read_total);
+    off_t stop = last < 0 ? file_size : last + 1;
+
+    int cur_len = 0;
+    for (off_t pos = first; pos < stop;) {
+        size_t to_read = stop - pos < BLOCK_SIZE ? (size_t)(stop - pos) : BLOCK_SIZE;
+        ssize_t bytes_read = pread(handle, buffer, to_read, pos);
+        if (bytes_read <= 0)
+            break;
+        *bytes_read_total += bytes_read;
+        process_block_simd_opt(buffer, bytes_read, total_line_num, line_num, &cur_len);
+        pos += bytes_read;
+    }
+}
+
+int filelines_sample(char* filepath, uint32_t* total_line_num, uint32_t* line_num, SampleEstimate* estimate,
+                     int num_chunks, size_t chunk_size, uint64_t seed) {
+    if (num_chunks <= 0)
+        num_chunks = SAMPLE_CHUNKS;
+    if (num_chunks < 2)
+        num_chunks = 2;
+    if (chunk_size == 0)
+        chunk_size = SAMPLE_CHUNK_SIZE;
+
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat st;
+    if (fstat(handle, &st) < 0) {
+        close(handle);
+        return -1;
+    }
+    off_t file_size = st.st_size;
+    if (estimate) {
+        memset(estimate, 0, sizeof(SampleEstimate));
+        estimate->file_size = file_size;
+    }
+
+    // 抽样总量不小于文件时直接完整扫描
+    if ((uint64_t)num_chunks * chunk_size >= (uint64_t)file_size) {
+        close(handle);
+        filelines_simd(filepath, total_line_num, line_num);
+        if (estimate)
+            estimate->sampled_bytes = file_size;
+        return 0;
+    }
+
+    char* buffer = (char*)aligned_alloc(64, BLOCK_SIZE);
+    uint32_t* chunk_line_num = (uint32_t*)malloc(MAX_LEN * sizeof(uint32_t));
+    double* sum = (double*)calloc(MAX_LEN, sizeof(double));
+    double* sum_sq = (double*)calloc(MAX_LEN, sizeof(double));
+    off_t* starts = (off_t*)malloc(num_chunks * sizeof(off_t));
+    if (!buffer || !chunk_line_num || !sum || !sum_sq || !starts) {
+        free(starts);
+        free(buffer);
+        free(chunk_line_num);
+        free(sum);
+        free(sum_sq);
+        close(handle);
+        return -1;
+    }
+
+    // 分层：第 k 层是 [k * stratum, (k + 1) * stratum)，层内随机取块的起点，块之间不会重叠
+    off_t stratum = file_size / num_chunks;
+    uint64_t state = seed;
+    for (int k = 0; k < num_chunks; k++) {
+        starts[k] = k * stratum + (off_t)(next_random(&state) % (uint64_t)(stratum - chunk_size + 1));
+        // 先把所有块的预读请求交给内核，随机读可以在设备上并行进行
+        posix_fadvise(handle, starts[k], chunk_size, POSIX_FADV_WILLNEED);
+    }
+
+    uint64_t bytes_read_total = 0;
+    double total_sum = 0, total_sum_sq = 0;
+    for (int k = 0; k < num_chunks; k++) {
+        uint32_t chunk_total = 0;
+        memset(chunk_line_num, 0, MAX_LEN * sizeof(uint32_t));
+        sample_chunk(handle, starts[k], starts[k] + chunk_size, file_size, buffer, &chunk_total, chunk_line_num,
+                     &bytes_read_total);
+        total_sum += chunk_total;
+        total_sum_sq += (double)chunk_total * chunk_total;
+        for (int i = 0; i < MAX_LEN; i++) {
+            sum[i] += chunk_line_num[i];
+            sum_sq[i] += (double)chunk_line_num[i] * chunk_line_num[i];
+        }
+    }
+
+    // 每层的外推值 y = count * file_size / chunk_size，估计值为 y 的均值，标准误差为 s(y) / sqrt(n)
+    double scale = (double)file_size / chunk_size;
+    double n = num_chunks;
+    *total_line_num += (uint32_t)llround(total_sum / n * scale);
+    for (int i = 0; i < MAX_LEN; i++)
+        line_num[i] += (uint32_t)llround(sum[i] / n * scale);
+    if (estimate) {
+        estimate->sampled_bytes = bytes_read_total;
+        estimate->num_chunks = num_chunks;
+        double variance = (total_sum_sq - total_sum * total_sum / n) / (n - 1);
+        estimate->total_line_num_ci = CONFIDENCE_Z * scale * sqrt(variance > 0 ? variance / n : 0);
+        for (int i = 0; i < MAX_LEN; i++) {
+            variance = (sum_sq[i] - sum[i] * sum[i] / n) / (n - 1);
+            estimate->line_num_ci[i] = CONFIDENCE_Z * scale * sqrt(variance > 0 ? variance / n : 0);
+        }
+    }
+
+    free(starts);
+    free(buffer);
+    free(chunk_line_num);
+    free(sum);
+    free(sum_sq);
+    close(handle);
+    return 0;
+}
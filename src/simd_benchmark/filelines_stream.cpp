@@ -0,0 +1,116 @@
+#include "filelines_stream.h"
+
+#include "simd_kernel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STREAM_PIPE_SIZE   (1 << 20) // 期望的管道容量，等于默认的 /proc/sys/fs/pipe-max-size
+#define STREAM_BUFFER_SIZE (1 << 20) // 读缓冲区，与管道容量相同，一次 read 可以取走整个管道
+#define STREAM_PAGE_SIZE   4096
+
+// 根据输入类型设置管道容量或预读提示
+static void prepare_stream(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        return;
+
+    if (S_ISFIFO(st.st_mode)) {
+        // 默认 64KB 的管道每写满一次就要唤醒一次读端；调大后写端（例如 zcat）可以连续写更久
+        // 超过 pipe-max-size 或用户的管道配额时会失败，保持原容量即可
+#ifdef F_SETPIPE_SZ
+        fcntl(fd, F_SETPIPE_SZ, STREAM_PIPE_SIZE);
+#endif
+    } else if (S_ISREG(st.st_mode)) {
+        // 标准输入重定向自普通文件时按顺序读取处理
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+// 读取一次，被信号中断时重试；返回 0 表示 EOF，< 0 表示出错
+static ssize_t read_stream(int fd, char* buffer, size_t size) {
+    while (1) {
+        ssize_t bytes_read = read(fd, buffer, size);
+        if (bytes_read >= 0 || errno != EINTR)
+            return bytes_read;
+    }
+}
+
+void filelines_stream(int fd, uint32_t* total_line_num, uint32_t* line_num) {
+    prepare_stream(fd);
+    // 按页对齐：管道读取时内核按页拷贝，对齐的目标地址也满足SIMD内核的对齐偏好
+    char* buffer = (char*)aligned_alloc(STREAM_PAGE_SIZE, STREAM_BUFFER_SIZE);
+    if (buffer == NULL)
+        return;
+
+    // 管道每次 read 返回的长度不固定，未结束的行长度通过 cur_len 带到下一次
+    int cur_len = 0;
+    while (1) {
+        ssize_t bytes_read = read_stream(fd, buffer, STREAM_BUFFER_SIZE);
+        if (bytes_read <= 0)
+            break;
+        process_block_simd_opt(buffer, bytes_read, total_line_num, line_num, &cur_len);
+    }
+
+    free(buffer);
+}
+
+void filelines_stream_wide(int fd, LineHistogram* hist, const DelimiterSet* set) {
+    prepare_stream(fd);
+    char* buffer = (char*)aligned_alloc(STREAM_PAGE_SIZE, STREAM_BUFFER_SIZE);
+    if (buffer == NULL)
+        return;
+
+    uint64_t cur_len = 0;
+    bool prev_cr = false;
+    while (1) {
+        ssize_t bytes_read = read_stream(fd, buffer, STREAM_BUFFER_SIZE);
+        if (bytes_read <= 0)
+            break;
+        if (set)
+            process_block_simd_delim(buffer, bytes_read, set, hist, &cur_len, &prev_cr);
+        else
+            process_block_simd_wide(buffer, bytes_read, hist, &cur_len);
+    }
+
+    free(buffer);
+}
+
+void filelines_stream_wc(int fd, LineHistogram* hist, WcCounts* counts) {
+    prepare_stream(fd);
+    char* buffer = (char*)aligned_alloc(STREAM_PAGE_SIZE, STREAM_BUFFER_SIZE);
+    if (buffer == NULL)
+        return;
+
+    // 单词和字符跨读取边界的状态保存在 counts 中
+    uint64_t cur_len = 0;
+    while (1) {
+        ssize_t bytes_read = read_stream(fd, buffer, STREAM_BUFFER_SIZE);
+        if (bytes_read <= 0)
+            break;
+        process_block_simd_wc(buffer, bytes_read, hist, &cur_len, counts);
+    }
+
+    free(buffer);
+}
+
+void filelines_stream_csv(int fd, CsvStats* stats) {
+    prepare_stream(fd);
+    char* buffer = (char*)aligned_alloc(STREAM_PAGE_SIZE, STREAM_BUFFER_SIZE);
+    if (buffer == NULL)
+        return;
+
+    while (1) {
+        ssize_t bytes_read = read_stream(fd, buffer, STREAM_BUFFER_SIZE);
+        if (bytes_read <= 0)
+            break;
+        process_block_simd_csv(buffer, bytes_read, stats);
+    }
+    csv_stats_finish(stats);
+
+    free(buffer);
+}
@@ -0,0 +1,232 @@
+#include "line_index.h"
+
+#include "simd_kernel.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define BLOCK_SIZE      (256 << 10) // 256KB
+#define SEEK_BLOCK_SIZE (64 << 10)  // 定位时的读取粒度，采样间隔内的行通常只需要读一两次
+
+struct SampleSink {
+    LineOffsetSink base; // 必须是第一个成员，回调里直接转换
+    std::vector<uint64_t>* samples;
+};
+
+static void record_sample(LineOffsetSink* sink, uint64_t line_offset) {
+    ((SampleSink*)sink)->samples->push_back(line_offset);
+}
+
+static bool write_all(int handle, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t written = write(handle, p, size);
+        if (written <= 0)
+            return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool write_index(const char* index_path, const LineIndexHeader* header, const std::vector<uint64_t>& samples) {
+    std::string tmp_path = std::string(index_path) + ".tmp";
+    int handle = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (handle < 0)
+        return false;
+
+    bool ok = write_all(handle, header, sizeof(LineIndexHeader));
+    if (header->wide_offsets) {
+        ok = ok && write_all(handle, samples.data(), samples.size() * sizeof(uint64_t));
+    } else {
+        size_t num_groups = (samples.size() + LINE_INDEX_GROUP - 1) / LINE_INDEX_GROUP;
+        std::vector<uint64_t> bases(num_groups);
+        std::vector<uint32_t> deltas(samples.size());
+        for (size_t k = 0; k < samples.size(); k++) {
+            if (k % LINE_INDEX_GROUP == 0)
+                bases[k / LINE_INDEX_GROUP] = samples[k];
+            deltas[k] = (uint32_t)(samples[k] - bases[k / LINE_INDEX_GROUP]);
+        }
+        ok = ok && write_all(handle, bases.data(), bases.size() * sizeof(uint64_t));
+        ok = ok && write_all(handle, deltas.data(), deltas.size() * sizeof(uint32_t));
+    }
+    ok = fsync(handle) == 0 && ok;
+    close(handle);
+
+    if (!ok || rename(tmp_path.c_str(), index_path) < 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+int line_index_build(const char* filepath, const char* index_path, LineHistogram* hist, uint32_t stride) {
+    if (stride == 0)
+        stride = LINE_INDEX_STRIDE;
+
+    int handle = open(filepath, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat st;
+    char* buffer = (char*)aligned_alloc(64, BLOCK_SIZE);
+    LineHistogram* scan_hist = (LineHistogram*)malloc(sizeof(LineHistogram));
+    if (fstat(handle, &st) < 0 || !buffer || !scan_hist) {
+        free(buffer);
+        free(scan_hist);
+        close(handle);
+        return -1;
+    }
+    posix_fadvise(handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+    line_histogram_init(scan_hist);
+
+    // 第0个采样点是第0行的开头
+    std::vector<uint64_t> samples;
+    samples.push_back(0);
+    SampleSink sink;
+    sink.base.stride = stride;
+    sink.base.lines = 0;
+    sink.base.next_line = stride;
+    sink.base.offset = 0;
+    sink.base.record = record_sample;
+    sink.samples = &samples;
+
+    // 只扫描到 fstat 时的大小，扫描期间追加的内容留给下次重建
+    uint64_t cur_len = 0;
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        size_t to_read = st.st_size - offset < BLOCK_SIZE ? (size_t)(st.st_size - offset) : BLOCK_SIZE;
+        ssize_t bytes_read = pread(handle, buffer, to_read, offset);
+        if (bytes_read <= 0)
+            break;
+        process_block_simd_indexed(buffer, bytes_read, scan_hist, &cur_len, &sink.base);
+        offset += bytes_read;
+    }
+    free(buffer);
+    close(handle);
+    if (offset != st.st_size) {
+        free(scan_hist);
+        return -1;
+    }
+
+    LineIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LINE_INDEX_MAGIC, 8);
+    header.version = LINE_INDEX_VERSION;
+    header.stride = stride;
+    header.dev = st.st_dev;
+    header.ino = st.st_ino;
+    header.mtime_sec = st.st_mtim.tv_sec;
+    header.mtime_nsec = st.st_mtim.tv_nsec;
+    header.file_size = st.st_size;
+    header.total_line_num = sink.base.lines;
+    header.num_samples = samples.size();
+    // 组内跨度放不进32位时整个文件改用64位绝对偏移
+    for (size_t k = 0; k < samples.size() && !header.wide_offsets; k++) {
+        if (samples[k] - samples[k / LINE_INDEX_GROUP * LINE_INDEX_GROUP] > UINT32_MAX)
+            header.wide_offsets = 1;
+    }
+
+    if (hist)
+        line_histogram_merge(hist, scan_hist);
+    free(scan_hist);
+    return write_index(index_path, &header, samples) ? 0 : -1;
+}
+
+int line_index_open(LineIndex* index, const char* index_path, int file_handle) {
+    memset(index, 0, sizeof(LineIndex));
+
+    int handle = open(index_path, O_RDONLY);
+    if (handle < 0)
+        return -1;
+    struct stat index_st;
+    if (fstat(handle, &index_st) < 0 || (size_t)index_st.st_size < sizeof(LineIndexHeader)) {
+        close(handle);
+        return -1;
+    }
+    void* map = mmap(NULL, index_st.st_size, PROT_READ, MAP_SHARED, handle, 0);
+    close(handle);
+    if (map == MAP_FAILED)
+        return -1;
+    index->map = map;
+    index->map_size = index_st.st_size;
+    index->header = (const LineIndexHeader*)map;
+
+    const LineIndexHeader* header = index->header;
+    struct stat st;
+    bool valid = memcmp(header->magic, LINE_INDEX_MAGIC, 8) == 0 && header->version == LINE_INDEX_VERSION &&
+                 header->stride > 0 && header->num_samples > 0 && fstat(file_handle, &st) == 0 &&
+                 header->dev == (uint64_t)st.st_dev && header->ino == (uint64_t)st.st_ino &&
+                 header->file_size == (uint64_t)st.st_size && header->mtime_sec == (int64_t)st.st_mtim.tv_sec &&
+                 header->mtime_nsec == (int64_t)st.st_mtim.tv_nsec;
+
+    if (valid) {
+        const char* data = (const char*)map + sizeof(LineIndexHeader);
+        size_t expected;
+        if (header->wide_offsets) {
+            index->offsets = (const uint64_t*)data;
+            expected = header->num_samples * sizeof(uint64_t);
+        } else {
+            size_t num_groups = (header->num_samples + LINE_INDEX_GROUP - 1) / LINE_INDEX_GROUP;
+            index->bases = (const uint64_t*)data;
+            index->deltas = (const uint32_t*)(data + num_groups * sizeof(uint64_t));
+            expected = num_groups * sizeof(uint64_t) + header->num_samples * sizeof(uint32_t);
+        }
+        valid = index->map_size == sizeof(LineIndexHeader) + expected;
+    }
+    if (!valid) {
+        line_index_close(index);
+        return -1;
+    }
+    return 0;
+}
+
+void line_index_close(LineIndex* index) {
+    if (index->map)
+        munmap(index->map, index->map_size);
+    memset(index, 0, sizeof(LineIndex));
+}
+
+off_t line_index_seek(const LineIndex* index, int file_handle, uint64_t line_no) {
+    const LineIndexHeader* header = index->header;
+    if (line_no > header->total_line_num)
+        return -1;
+
+    uint64_t k = line_no / header->stride;
+    uint64_t offset = line_index_sample(index, k);
+    uint64_t remaining = line_no - k * header->stride;
+
+    if (remaining > 0) {
+        char* buffer = (char*)aligned_alloc(64, SEEK_BLOCK_SIZE);
+        if (!buffer)
+            return -1;
+        // 从采样点向后数 remaining 个换行符，下一字节就是目标行的开头
+        bool found = false;
+        while (!found && offset < header->file_size) {
+            ssize_t bytes_read = pread(file_handle, buffer, SEEK_BLOCK_SIZE, offset);
+            if (bytes_read <= 0)
+                break;
+            ssize_t pos = find_nth_newline(buffer, bytes_read, &remaining);
+            if (pos >= 0) {
+                offset += pos + 1;
+                found = true;
+            } else {
+                offset += bytes_read;
+            }
+        }
+        free(buffer);
+        if (!found)
+            return -1;
+    }
+
+    // 最后一个换行符之后没有内容时，第 total_line_num 行不存在
+    if (offset >= header->file_size)
+        return -1;
+    return (off_t)offset;
+}
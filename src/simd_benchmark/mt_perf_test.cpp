@@ -1,78 +1,74 @@
 /*
  * 多线程性能对比测试程序
- * 对比：标量 vs 单线程SIMD vs 多线程SIMD（生产者-消费者）
+ * 对比：标量 vs 单线程SIMD vs 多线程SIMD（生产者-消费者） vs 多线程SIMD（分段）
+ * --numa 时其余版本都不绑核，额外加入按 NUMA 节点绑核的多线程版本，并输出每个版本各轮之间的波动
+ *
+ * 每个版本先在每次运行前把文件逐出页缓存测一组（冷缓存），再在文件完全缓存后测一组（热缓存），两者分开统计；
+ * 每次运行前用 mincore 记录文件有多少在页缓存中。--warm 时只跑热缓存
+ * 每组由 bench_harness 预热并自适应重复运行，报告中位数、最快、标准差和 95% 置信区间，可输出 JSON/CSV
+ * --hugepages 时额外加入读缓冲区使用大页的版本
+ * 每次运行同时记录硬件计数器（cycles/指令/LLC/dTLB/分支缺失），不可用时显示 n/a
  */
 
+#include "bench_filelines.h"
 #include "filelines_baseline.h"
 #include "filelines_mt.h"
 #include "filelines_simd_opt.h"
-#include "find_most_freq.h"
+#include "huge_pages.h"
+#include "numa_topology.h"
+#include "perf_counters.h"
+#include "simd_kernel.h"
 
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 
 using namespace std;
 
-struct TestResult {
-    double time_seconds;
-    double throughput_mb_s;
-    uint32_t total_lines;
-    uint32_t most_freq_len;
-    uint32_t most_freq_count;
+// 待测版本
+struct TestCase {
+    const char* name;
+    void (*func)(char*, uint32_t*, uint32_t*);
 };
 
-TestResult run_test(char* filepath, void (*test_func)(char*, uint32_t*, uint32_t*), const char* version_name) {
-    uint32_t line_num[MAX_LEN];
-    uint32_t total_line_num = 0;
-
-    memset(line_num, 0, sizeof(line_num));
-
-    cout << "  测试 " << version_name << "..." << flush;
-
-    auto start = chrono::high_resolution_clock::now();
-    test_func(filepath, &total_line_num, line_num);
-    auto end = chrono::high_resolution_clock::now();
-
-    chrono::duration<double> duration = end - start;
-
-    uint32_t most_freq_len, most_freq_len_linenum;
-    find_most_freq_line(line_num, &most_freq_len, &most_freq_len_linenum);
-
-    FILE* fp = fopen(filepath, "rb");
-    long file_size = 0;
-    if (fp) {
-        fseek(fp, 0, SEEK_END);
-        file_size = ftell(fp);
-        fclose(fp);
-    }
-
-    TestResult result;
-    result.time_seconds = duration.count();
-    result.throughput_mb_s = (file_size / (1024.0 * 1024.0)) / duration.count();
-    result.total_lines = total_line_num;
-    result.most_freq_len = most_freq_len;
-    result.most_freq_count = most_freq_len_linenum;
-
-    // 这个地方也非常神奇，你要是改用下面的cout，统计出来的执行时间就会变长:)
-    cout << " 完成 (" << fixed << setprecision(3) << duration.count() << "s)" << endl;
-    //    cout << " 完成 (" << fixed << setprecision(3) << duration.count() << "s, " << setprecision(1)
-    //         << result.throughput_mb_s << " MB/s)" << endl;
-
-    return result;
-}
-
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "用法: %s <filepath>\n", argv[0]);
+    // --direct: 额外加入 O_DIRECT 版本，与页缓存读取对比
+    // --numa: 额外加入 NUMA 绑核版本，与不绑核的版本对比
+    // --warm: 只测热缓存，不做冷缓存运行
+    // --hugepages: 额外加入大页读缓冲区版本
+    // 其余选项（运行次数、JSON/CSV 输出）见 bench_usage
+    bool compare_direct = false, compare_numa = false, warm_only = false, compare_huge = false, bad_option = false;
+    BenchConfig config;
+    bench_config_init(&config);
+    for (int i = 1; i < argc - 1; i++) {
+        int used = bench_parse_option(&config, argc - 1, argv, i);
+        if (used != 0) {
+            if (used < 0)
+                bad_option = true;
+            else
+                i += used - 1;
+        } else if (strcmp(argv[i], "--direct") == 0)
+            compare_direct = true;
+        else if (strcmp(argv[i], "--numa") == 0)
+            compare_numa = true;
+        else if (strcmp(argv[i], "--warm") == 0)
+            warm_only = true;
+        else if (strcmp(argv[i], "--hugepages") == 0)
+            compare_huge = true;
+        else
+            bad_option = true;
+    }
+    if (argc < 2 || bad_option) {
+        fprintf(stderr, "用法: %s [--direct] [--numa] [--warm] [--hugepages] [选项] <filepath>\n", argv[0]);
         fprintf(stderr, "示例: %s test_2gb.txt\n", argv[0]);
+        fprintf(stderr, "选项:\n%s", bench_usage());
         return 1;
     }
 
-    char* filepath = argv[1];
+    char* filepath = argv[argc - 1];
 
     FILE* fp = fopen(filepath, "rb");
     if (!fp) {
@@ -91,96 +87,193 @@ int main(int argc, char* argv[]) {
     cout << "测试文件: " << filepath << endl;
     cout << "文件大小: " << fixed << setprecision(2) << (file_size / (1024.0 * 1024.0 * 1024.0)) << " GB" << endl;
     cout << "块大小: 256 KB" << endl;
-    cout << "缓冲队列: 4 块\n" << endl;
+    cout << "SIMD内核: " << simd_kernel_name() << endl;
+    cout << "缓冲队列: 4 块" << endl;
+    PerfCounters probe;
+    int num_counters = perf_counters_open(&probe);
+    perf_counters_close(&probe);
+    if (num_counters == 0)
+        cout << "硬件计数器: 不可用（perf_event_paranoid 限制或没有 PMU），计数器列显示 n/a\n" << endl;
+    else
+        cout << "硬件计数器: " << num_counters << "/" << PERF_NUM_EVENTS << " 个事件可用\n" << endl;
+    if (compare_numa) {
+        NumaTopology topo;
+        numa_topology_detect(&topo);
+        cout << "NUMA节点: " << topo.num_nodes << " (";
+        for (int n = 0; n < topo.num_nodes; n++)
+            cout << (n > 0 ? ", " : "") << "node" << topo.nodes[n].id << ": " << topo.nodes[n].num_cpus << " CPU";
+        cout << ")\n" << endl;
+        numa_set_placement(NUMA_PLACEMENT_OFF);
+    }
 
-    cout << "运行测试（每个版本测试3次取平均）...\n" << endl;
+    cout << "运行测试（每个版本" << (warm_only ? "" : "冷、热缓存各") << "预热 " << config.warmups << " 次，再运行 "
+         << config.min_runs << "~" << config.max_runs << " 次直到置信区间足够窄）...\n"
+         << endl;
 
-    // 测试3次取平均
-    TestResult baseline_results[3], simd_results[3], mt_results[3];
+    // 参与对比的版本，第一个作为加速比基准
+    vector<TestCase> cases = {
+        {"标量版本", filelines_baseline},
+        {"单线程SIMD版本", filelines_simd},
+        {"单线程SIMD版本(mmap)", filelines_simd_mmap},
+        {"多线程SIMD版本", filelines_mt},
+        {"io_uring SIMD版本", [](char* f, uint32_t* t, uint32_t* l) { filelines_mt_uring(f, t, l); }},
+        {"分段多线程SIMD版本", [](char* f, uint32_t* t, uint32_t* l) { filelines_mt_split(f, t, l); }},
+        {"分段多线程SIMD版本(mmap)", [](char* f, uint32_t* t, uint32_t* l) { filelines_mt_split(f, t, l, 0, true); }},
+    };
+    if (compare_direct) {
+        cases.push_back({"多线程SIMD版本(O_DIRECT)", filelines_mt_direct});
+        cases.push_back({"分段多线程SIMD版本(O_DIRECT)",
+                         [](char* f, uint32_t* t, uint32_t* l) { filelines_mt_split(f, t, l, 0, false, true); }});
+    }
+    if (compare_numa) {
+        // 只在这两个版本里打开绑核，其余版本保持内核调度
+        cases.push_back({"多线程SIMD版本(NUMA绑核)", [](char* f, uint32_t* t, uint32_t* l) {
+                             numa_set_placement(NUMA_PLACEMENT_ON);
+                             filelines_mt(f, t, l);
+                             numa_set_placement(NUMA_PLACEMENT_OFF);
+                         }});
+        cases.push_back({"分段多线程SIMD版本(NUMA绑核)", [](char* f, uint32_t* t, uint32_t* l) {
+                             numa_set_placement(NUMA_PLACEMENT_ON);
+                             filelines_mt_split(f, t, l);
+                             numa_set_placement(NUMA_PLACEMENT_OFF);
+                         }});
+    }
+    if (compare_huge) {
+        cases.push_back({"单线程SIMD版本(大页)", [](char* f, uint32_t* t, uint32_t* l) {
+                             huge_pages_set_enabled(true);
+                             filelines_simd(f, t, l);
+                             huge_pages_set_enabled(false);
+                         }});
+        cases.push_back({"多线程SIMD版本(大页)", [](char* f, uint32_t* t, uint32_t* l) {
+                             huge_pages_set_enabled(true);
+                             filelines_mt(f, t, l);
+                             huge_pages_set_enabled(false);
+                         }});
+        cases.push_back({"分段多线程SIMD版本(大页)", [](char* f, uint32_t* t, uint32_t* l) {
+                             huge_pages_set_enabled(true);
+                             filelines_mt_split(f, t, l);
+                             huge_pages_set_enabled(false);
+                         }});
+    }
+    const int num_cases = cases.size();
+
+    // 冷、热缓存各登记一组
+    vector<string> cold_names(num_cases);
+    vector<FilelinesBenchCase> cold_cases(num_cases), warm_cases(num_cases);
+    vector<BenchCase*> cold_list, warm_list;
+    for (int c = 0; c < num_cases; c++) {
+        cold_names[c] = string(cases[c].name) + " [冷]";
+        filelines_bench_case_init(&cold_cases[c], cold_names[c].c_str(), filepath, cases[c].func, FILELINES_CACHE_COLD);
+        filelines_bench_case_init(&warm_cases[c], cases[c].name, filepath, cases[c].func, FILELINES_CACHE_WARM);
+        cold_list.push_back(&cold_cases[c].base);
+        warm_list.push_back(&warm_cases[c].base);
+    }
 
-    for (int i = 0; i < 3; i++) {
-        cout << "[轮次 " << (i + 1) << "/3]" << endl;
-        baseline_results[i] = run_test(filepath, filelines_baseline, "标量版本        ");
-        simd_results[i] = run_test(filepath, filelines_simd, "单线程SIMD版本  ");
-        mt_results[i] = run_test(filepath, filelines_mt, "多线程SIMD版本  ");
+    vector<BenchResult> cold_results, results;
+    bool drop_failed = false;
+    if (!warm_only) {
+        cout << "[冷缓存]" << endl;
+        bench_run_all(cold_list, &config, &cold_results);
+        for (int c = 0; c < num_cases; c++)
+            drop_failed = drop_failed || cold_cases[c].drop_failed;
         cout << endl;
     }
-
-    // 计算平均值
-    TestResult baseline_avg = {0}, simd_avg = {0}, mt_avg = {0};
-
-    for (int i = 0; i < 3; i++) {
-        baseline_avg.time_seconds += baseline_results[i].time_seconds / 3.0;
-        baseline_avg.throughput_mb_s += baseline_results[i].throughput_mb_s / 3.0;
-        simd_avg.time_seconds += simd_results[i].time_seconds / 3.0;
-        simd_avg.throughput_mb_s += simd_results[i].throughput_mb_s / 3.0;
-        mt_avg.time_seconds += mt_results[i].time_seconds / 3.0;
-        mt_avg.throughput_mb_s += mt_results[i].throughput_mb_s / 3.0;
+    cout << "[热缓存]" << endl;
+    bench_run_all(warm_list, &config, &results);
+    cout << endl;
+
+    auto print_table = [&](const char* title, const vector<BenchResult>& table,
+                           const vector<FilelinesBenchCase>& table_cases) {
+        cout << "========================================" << endl;
+        cout << "          " << title << endl;
+        cout << "========================================\n" << endl;
+
+        cout << left << setw(34) << "版本" << setw(6) << "次数" << setw(12) << "中位数(秒)" << setw(12) << "最快(秒)"
+             << setw(24) << "95%置信区间(秒)" << setw(18) << "吞吐量(MB/s)" << setw(12) << "缓存" << setw(12)
+             << "加速比" << endl;
+        cout << string(130, '-') << endl;
+
+        for (int c = 0; c < num_cases; c++) {
+            const BenchResult& r = table[c];
+            double speedup = table[0].median / r.median;
+            char ci[64];
+            snprintf(ci, sizeof(ci), "[%.4f, %.4f]", r.ci_low, r.ci_high);
+            cout << left << setw(34) << cases[c].name << setw(6) << r.samples.size() << fixed << setprecision(4)
+                 << setw(12) << r.median << setw(12) << r.min << setw(24) << ci << setprecision(2) << setw(18)
+                 << r.throughput << setw(12)
+                 << to_string((int)(filelines_bench_resident(&table_cases[c]) * 100 + 0.5)) + "%" << speedup << "x"
+                 << endl;
+        }
+
+        cout << string(130, '-') << endl;
+
+        char perf_line[256];
+        cout << "硬件计数器:" << endl;
+        for (int c = 0; c < num_cases; c++) {
+            perf_sample_format(&table[c].perf, perf_line, sizeof(perf_line));
+            cout << "  " << left << setw(34) << cases[c].name << perf_line << endl;
+        }
+    };
+    if (!warm_only) {
+        print_table("测试结果（冷缓存）", cold_results, cold_cases);
+        if (drop_failed)
+            cout << "  警告: 逐出页缓存失败，冷缓存结果不可信" << endl;
+        cout << endl;
+    }
+    print_table("测试结果（热缓存）", results, warm_cases);
+
+    if (compare_numa) {
+        // 各次运行之间的波动：(最慢 - 最快) / 平均
+        cout << "\n各次运行波动（热缓存）:" << endl;
+        for (int c = 0; c < num_cases; c++) {
+            cout << "  " << left << setw(34) << cases[c].name << fixed << setprecision(1)
+                 << (results[c].max - results[c].min) / results[c].mean * 100 << "%" << endl;
+        }
     }
 
-    baseline_avg.total_lines = baseline_results[0].total_lines;
-    baseline_avg.most_freq_len = baseline_results[0].most_freq_len;
-    baseline_avg.most_freq_count = baseline_results[0].most_freq_count;
-    simd_avg.total_lines = simd_results[0].total_lines;
-    simd_avg.most_freq_len = simd_results[0].most_freq_len;
-    simd_avg.most_freq_count = simd_results[0].most_freq_count;
-    mt_avg.total_lines = mt_results[0].total_lines;
-    mt_avg.most_freq_len = mt_results[0].most_freq_len;
-    mt_avg.most_freq_count = mt_results[0].most_freq_count;
-
-    cout << "========================================" << endl;
-    cout << "          平均测试结果" << endl;
-    cout << "========================================\n" << endl;
-
-    cout << left << setw(25) << "版本" << setw(15) << "时间(秒)" << setw(18) << "吞吐量(MB/s)" << setw(12) << "加速比"
-         << endl;
-    cout << string(70, '-') << endl;
-
-    cout << left << setw(25) << "标量版本" << fixed << setprecision(4) << setw(15) << baseline_avg.time_seconds
-         << setprecision(2) << setw(18) << baseline_avg.throughput_mb_s << "1.00x" << endl;
-
-    double simd_speedup = baseline_avg.time_seconds / simd_avg.time_seconds;
-    cout << left << setw(25) << "单线程SIMD版本" << fixed << setprecision(4) << setw(15) << simd_avg.time_seconds
-         << setprecision(2) << setw(18) << simd_avg.throughput_mb_s << setprecision(2) << simd_speedup << "x" << endl;
-
-    double mt_speedup = baseline_avg.time_seconds / mt_avg.time_seconds;
-    cout << left << setw(25) << "多线程SIMD版本" << fixed << setprecision(4) << setw(15) << mt_avg.time_seconds
-         << setprecision(2) << setw(18) << mt_avg.throughput_mb_s << setprecision(2) << mt_speedup << "x" << endl;
-
-    cout << string(70, '-') << endl;
-
-    // 详细性能分析
-    cout << "\n性能提升分析:" << endl;
-    cout << "  标量 → 单线程SIMD:" << endl;
-    cout << "    加速比: " << fixed << setprecision(2) << simd_speedup << "x (" << setprecision(1)
-         << (simd_speedup - 1.0) * 100 << "% 提升)" << endl;
-    cout << "    吞吐量: " << setprecision(2) << baseline_avg.throughput_mb_s << " → " << simd_avg.throughput_mb_s
-         << " MB/s" << endl;
-
-    double mt_vs_simd = simd_avg.time_seconds / mt_avg.time_seconds;
-    cout << "\n  单线程SIMD → 多线程SIMD:" << endl;
-    cout << "    加速比: " << fixed << setprecision(2) << mt_vs_simd << "x (" << setprecision(1)
-         << (mt_vs_simd - 1.0) * 100 << "% 提升)" << endl;
-    cout << "    吞吐量: " << setprecision(2) << simd_avg.throughput_mb_s << " → " << mt_avg.throughput_mb_s << " MB/s"
-         << endl;
+    // 详细性能分析：每个版本相对上一个版本的提升
+    cout << "\n性能提升分析（热缓存）:" << endl;
+    for (int c = 1; c < num_cases; c++) {
+        double step_speedup = results[c - 1].median / results[c].median;
+        cout << "  " << cases[c - 1].name << " → " << cases[c].name << ":" << endl;
+        cout << "    加速比: " << fixed << setprecision(2) << step_speedup << "x (" << setprecision(1)
+             << (step_speedup - 1.0) * 100 << "% 提升)" << endl;
+        cout << "    吞吐量: " << setprecision(2) << results[c - 1].throughput << " → " << results[c].throughput
+             << " MB/s" << endl;
+    }
 
-    cout << "\n  标量 → 多线程SIMD (总提升):" << endl;
-    cout << "    加速比: " << fixed << setprecision(2) << mt_speedup << "x (" << setprecision(1)
-         << (mt_speedup - 1.0) * 100 << "% 提升)" << endl;
-    cout << "    吞吐量: " << setprecision(2) << baseline_avg.throughput_mb_s << " → " << mt_avg.throughput_mb_s
-         << " MB/s" << endl;
+    double total_speedup = results[0].median / results[num_cases - 1].median;
+    cout << "\n  " << cases[0].name << " → " << cases[num_cases - 1].name << " (总提升):" << endl;
+    cout << "    加速比: " << fixed << setprecision(2) << total_speedup << "x (" << setprecision(1)
+         << (total_speedup - 1.0) * 100 << "% 提升)" << endl;
 
     // 验证结果一致性
-    bool results_match = (baseline_avg.total_lines == simd_avg.total_lines) &&
-                         (simd_avg.total_lines == mt_avg.total_lines) &&
-                         (baseline_avg.most_freq_len == mt_avg.most_freq_len);
+    const FilelinesBenchCase& reference = warm_cases[0];
+    bool results_match = true;
+    for (int c = 0; c < num_cases; c++) {
+        results_match = results_match && results[c].stable && (warm_cases[c].total_lines == reference.total_lines) &&
+                        (warm_cases[c].most_freq_len == reference.most_freq_len) &&
+                        (warm_cases[c].most_freq_count == reference.most_freq_count);
+    }
+    for (int c = 0; c < num_cases && !warm_only; c++) {
+        results_match = results_match && cold_results[c].stable &&
+                        (cold_cases[c].total_lines == reference.total_lines) &&
+                        (cold_cases[c].most_freq_len == reference.most_freq_len) &&
+                        (cold_cases[c].most_freq_count == reference.most_freq_count);
+    }
 
     cout << "\n结果验证:" << endl;
-    cout << "  总行数: " << baseline_avg.total_lines << (results_match ? " ✓" : " ✗") << endl;
-    cout << "  最频繁长度: " << baseline_avg.most_freq_len << " (出现 " << baseline_avg.most_freq_count << " 次)"
+    cout << "  总行数: " << reference.total_lines << (results_match ? " ✓" : " ✗") << endl;
+    cout << "  最频繁长度: " << reference.most_freq_len << " (出现 " << reference.most_freq_count << " 次)"
          << (results_match ? " ✓" : " ✗") << endl;
     cout << "  数据一致性: " << (results_match ? "通过 ✓" : "失败 ✗") << endl;
 
+    // JSON/CSV 中冷缓存结果的名字带 [冷] 后缀
+    vector<BenchResult> all_results(cold_results);
+    all_results.insert(all_results.end(), results.begin(), results.end());
+    if (!bench_emit(&config, "mt_perf_test", all_results))
+        results_match = false;
+
     cout << "\n========================================\n" << endl;
 
     return results_match ? 0 : 1;
@@ -0,0 +1,60 @@
+#include "range_scan.h"
+
+#include "direct_io.h"
+#include "page_cache.h"
+#include "simd_kernel.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+void scan_range_data(RangeBoundary* boundary, const char* data, ssize_t size, LineHistogram* hist, uint64_t* cur_len) {
+    if (!boundary->has_newline) {
+        const char* newline = (const char*)memchr(data, '\n', size);
+        if (newline == NULL) {
+            boundary->head_len += size;
+            return;
+        }
+        boundary->head_len += newline - data;
+        boundary->has_newline = true;
+        size -= newline - data + 1;
+        data = newline + 1;
+    }
+    process_block_simd_wide(data, size, hist, cur_len);
+}
+
+bool scan_file_range(int handle, off_t start, off_t end, char* buffer, size_t buffer_size, RangeBoundary* boundary,
+                     LineHistogram* hist) {
+    uint64_t cur_len = 0;
+    off_t offset = start;
+    // 多个线程各自扫描一段时内核的顺序预读识别不出来，这里按区间显式提示；O_DIRECT 不经过页缓存
+    int flags = fcntl(handle, F_GETFL);
+    bool readahead = flags >= 0 && !(flags & O_DIRECT);
+    if (readahead)
+        page_cache_readahead(handle, start, READAHEAD_DISTANCE, end);
+    while (offset < end) {
+        size_t to_read = (size_t)(end - offset) < buffer_size ? (size_t)(end - offset) : buffer_size;
+        ssize_t bytes_read = read_for_scan(handle, buffer, to_read, offset);
+        if (bytes_read <= 0)
+            break;
+        if (readahead)
+            page_cache_readahead(handle, offset + READAHEAD_DISTANCE, bytes_read, end);
+        offset += bytes_read;
+
+        // 第一个换行符之前的内容先不统计，留给合并阶段和上一个区间拼接
+        scan_range_data(boundary, buffer, bytes_read, hist, &cur_len);
+    }
+    boundary->tail_len = cur_len;
+    return offset >= end;
+}
+
+uint64_t stitch_ranges(const RangeBoundary* boundaries, int num_ranges, LineHistogram* hist, uint64_t carry) {
+    for (int i = 0; i < num_ranges; i++) {
+        if (boundaries[i].has_newline) {
+            line_histogram_add(hist, carry + boundaries[i].head_len);
+            carry = boundaries[i].tail_len;
+        } else {
+            carry += boundaries[i].head_len;
+        }
+    }
+    return carry;
+}
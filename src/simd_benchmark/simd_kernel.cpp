@@ -0,0 +1,858 @@
+#include "simd_kernel.h"
+
+#include "find_most_freq.h"
+
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+// 各指令集版本只负责把每64字节生成一个换行符位图，统计逻辑由下面的计数器完成
+
+// 计数器的状态在扫描过程中保存在局部变量里（避免和直方图数组别名导致反复读写内存），扫描结束后再写回
+
+// 旧接口：32位计数，长行计入最后一个桶
+struct LegacyCounter {
+    uint32_t* line_num;
+    uint32_t total_line_num;
+    int cur_len;
+
+    ALWAYS_INLINE void add_line(int line_length) {
+        if (line_length < MAX_LEN) {
+            ++line_num[line_length];
+        } else {
+            ++line_num[MAX_LEN - 1];
+        }
+    }
+
+    // 处理一个64字节块的换行符位图
+    ALWAYS_INLINE void on_mask(uint64_t mask) {
+        if (__builtin_expect(mask == 0, 0)) {
+            // 快速路径：没有换行符
+            cur_len += 64;
+            return;
+        }
+        total_line_num += __builtin_popcountll(mask);
+        int last_pos = -1;
+        while (mask != 0) {
+            int pos = __builtin_ctzll(mask);
+            add_line(cur_len + (pos - last_pos - 1));
+            cur_len = 0;
+            last_pos = pos;
+            // 高效清除这个已经处理过的 '1'
+            mask &= (mask - 1);
+        }
+        cur_len = 63 - last_pos;
+    }
+
+    // 统计类计数器总是扫描完整个数据块，循环里的 done() 检查在编译期消除
+    ALWAYS_INLINE bool done() const { return false; }
+
+    // 处理不足64字节的尾部
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            if (buffer[i] == '\n') {
+                ++total_line_num;
+                add_line(cur_len);
+                cur_len = 0;
+            } else {
+                ++cur_len;
+            }
+        }
+    }
+};
+
+// 64位计数 + 两级直方图
+struct WideCounter {
+    LineHistogram* hist;
+    uint64_t total_line_num;
+    uint64_t cur_len;
+
+    ALWAYS_INLINE void add_line(uint64_t line_length) {
+        if (__builtin_expect(line_length < MAX_LEN, 1))
+            ++hist->dense[line_length];
+        else
+            line_histogram_add_long(hist, line_length);
+    }
+
+    ALWAYS_INLINE void on_mask(uint64_t mask) {
+        if (__builtin_expect(mask == 0, 0)) {
+            cur_len += 64;
+            return;
+        }
+        total_line_num += __builtin_popcountll(mask);
+        int last_pos = -1;
+        while (mask != 0) {
+            int pos = __builtin_ctzll(mask);
+            add_line(cur_len + (pos - last_pos - 1));
+            cur_len = 0;
+            last_pos = pos;
+            mask &= (mask - 1);
+        }
+        cur_len = 63 - last_pos;
+    }
+
+    ALWAYS_INLINE bool done() const { return false; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            if (buffer[i] == '\n') {
+                ++total_line_num;
+                add_line(cur_len);
+                cur_len = 0;
+            } else {
+                ++cur_len;
+            }
+        }
+    }
+};
+
+// 64位统计 + 行偏移采样：每 stride 行记录一次下一行的起始偏移，用于建立行号索引
+// 只有跨过采样行的那个64字节块才需要定位具体是哪一位，其余块只多一次比较
+struct IndexedCounter {
+    WideCounter wide;   // wide.total_line_num 只统计本次调用扫描到的行
+    LineOffsetSink* sink;
+    uint64_t stride;
+    uint64_t offset;    // 当前64字节块在文件中的偏移
+    uint64_t next_line; // 下一个采样行号，相对本次调用开始时的行数
+
+    ALWAYS_INLINE void record(uint64_t line_offset) {
+        sink->record(sink, line_offset);
+        next_line += stride;
+    }
+
+    ALWAYS_INLINE void on_mask(uint64_t mask) {
+        uint64_t lines_before = wide.total_line_num;
+        wide.on_mask(mask);
+        while (__builtin_expect(next_line <= wide.total_line_num, 0)) {
+            // 第 (next_line - lines_before) 个换行符之后就是采样行的开头
+            uint64_t bits = mask;
+            for (uint64_t skip = next_line - lines_before - 1; skip > 0; skip--)
+                bits &= bits - 1;
+            record(offset + __builtin_ctzll(bits) + 1);
+        }
+        offset += 64;
+    }
+
+    ALWAYS_INLINE bool done() const { return false; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            if (buffer[i] == '\n') {
+                ++wide.total_line_num;
+                wide.add_line(wide.cur_len);
+                wide.cur_len = 0;
+                if (wide.total_line_num == next_line)
+                    record(offset + i + 1);
+            } else {
+                ++wide.cur_len;
+            }
+        }
+        offset += size;
+    }
+};
+
+// 定位第 remaining 个换行符（从1开始计数），找到后提前结束扫描
+struct NthNewlineCounter {
+    uint64_t remaining;
+    ssize_t pos;   // 当前64字节块在数据块中的偏移
+    ssize_t found; // 找到的换行符位置，没找到为 -1
+
+    ALWAYS_INLINE void on_mask(uint64_t mask) {
+        uint64_t count = __builtin_popcountll(mask);
+        if (count < remaining) {
+            remaining -= count;
+            pos += 64;
+            return;
+        }
+        for (uint64_t skip = remaining - 1; skip > 0; skip--)
+            mask &= mask - 1;
+        found = pos + __builtin_ctzll(mask);
+        remaining = 0;
+    }
+
+    ALWAYS_INLINE bool done() const { return found >= 0; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size && found < 0; i++) {
+            if (buffer[i] == '\n' && --remaining == 0)
+                found = pos + i;
+        }
+    }
+};
+
+// 可配置分隔符 + 可选的 CRLF 模式（64位计数）
+// on_masks 同时拿到分隔符位图和 '\r' 位图：紧挨在分隔符前面的 '\r' 不计入行长度
+struct DelimCounter {
+    WideCounter wide;
+    const DelimiterSet* set;
+    uint64_t prev_cr; // 上一个64字节块（或上一次调用）的最后一个字节是否为 '\r'
+
+    ALWAYS_INLINE void on_masks(uint64_t mask, uint64_t cr_mask) {
+        if (!set->crlf) {
+            wide.on_mask(mask);
+            return;
+        }
+        uint64_t ends_with_cr = mask & ((cr_mask << 1) | prev_cr);
+        prev_cr = cr_mask >> 63;
+        if (__builtin_expect(mask == 0, 0)) {
+            wide.cur_len += 64;
+            return;
+        }
+        wide.total_line_num += __builtin_popcountll(mask);
+        int last_pos = -1;
+        while (mask != 0) {
+            int pos = __builtin_ctzll(mask);
+            wide.add_line(wide.cur_len + (pos - last_pos - 1) - ((ends_with_cr >> pos) & 1));
+            wide.cur_len = 0;
+            last_pos = pos;
+            mask &= (mask - 1);
+        }
+        wide.cur_len = 63 - last_pos;
+    }
+
+    ALWAYS_INLINE bool done() const { return false; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            unsigned char c = (unsigned char)buffer[i];
+            if (set->table[c]) {
+                ++wide.total_line_num;
+                wide.add_line(wide.cur_len - (set->crlf ? prev_cr : 0));
+                wide.cur_len = 0;
+            } else {
+                ++wide.cur_len;
+            }
+            prev_cr = c == '\r';
+        }
+    }
+};
+
+// wc 风格的融合计数：行长度直方图 + 单词数 + UTF-8 字符数，一遍扫描完成
+// on_masks 拿到换行符、空白字符和 UTF-8 后续字节（10xxxxxx）三个位图：
+//   单词数 = 前一个字节是空白、当前字节不是空白的位置数（前一个字节的状态跨块带入）
+//   字符数 = 不是后续字节的字节数
+struct WcCounter {
+    WideCounter wide;
+    uint64_t words;
+    uint64_t chars;
+    uint64_t prev_space; // 上一个字节是否为空白，文件开头视为空白
+    bool codepoint_len;  // 行长度按字符数而不是字节数统计
+
+    ALWAYS_INLINE void on_masks(uint64_t newline, uint64_t space, uint64_t cont) {
+        words += __builtin_popcountll(~space & ((space << 1) | prev_space));
+        prev_space = space >> 63;
+        chars += 64 - __builtin_popcountll(cont);
+        if (!codepoint_len) {
+            wide.on_mask(newline);
+            return;
+        }
+
+        // 按字符计长度：每行的字节数减去其中的后续字节数
+        if (newline == 0) {
+            wide.cur_len += 64 - __builtin_popcountll(cont);
+            return;
+        }
+        wide.total_line_num += __builtin_popcountll(newline);
+        int last_pos = -1;
+        while (newline != 0) {
+            int pos = __builtin_ctzll(newline);
+            uint64_t line_bits = ((1ULL << pos) - 1) & ~((1ULL << (last_pos + 1)) - 1);
+            wide.add_line(wide.cur_len + (pos - last_pos - 1) - __builtin_popcountll(cont & line_bits));
+            wide.cur_len = 0;
+            last_pos = pos;
+            newline &= (newline - 1);
+        }
+        // 最后一个换行符之后的部分（last_pos 为63时没有剩余）
+        wide.cur_len = last_pos == 63 ? 0 : (63 - last_pos) - __builtin_popcountll(cont >> (last_pos + 1));
+    }
+
+    ALWAYS_INLINE bool done() const { return false; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            unsigned char c = (unsigned char)buffer[i];
+            bool space = c == ' ' || (c >= '\t' && c <= '\r');
+            bool is_cont = (c & 0xc0) == 0x80;
+            if (!space && prev_space)
+                ++words;
+            prev_space = space;
+            if (!is_cont)
+                ++chars;
+
+            if (c == '\n') {
+                ++wide.total_line_num;
+                wide.add_line(wide.cur_len);
+                wide.cur_len = 0;
+            } else if (!codepoint_len || !is_cont) {
+                ++wide.cur_len;
+            }
+        }
+    }
+};
+
+// CSV/TSV 列统计：换行符结束一条记录，分隔符结束一个字段，引号内的两者都只是字段内容
+// on_masks 拿到的 quoted 是本块引号位图的前缀异或（开引号所在位为1，闭引号所在位为0），
+// 与上一块结束时的引号状态异或后就是每个字节是否在引号内；"" 转义连续翻转两次，不需要特殊处理
+struct CsvCounter {
+    CsvStats* stats;
+    uint64_t field_len;
+    uint64_t column;
+    uint64_t in_quote; // 全1表示上一个字节在引号内
+    uint64_t prev_cr;
+
+    ALWAYS_INLINE void end_field(uint64_t len) {
+        line_histogram_add(&stats->columns[column < CSV_MAX_COLUMNS ? column : CSV_MAX_COLUMNS - 1], len);
+        ++column;
+    }
+
+    ALWAYS_INLINE void end_row(uint64_t len) {
+        // 空行（包括只有 "\r\n" 的行）不是记录
+        if (column == 0 && len == 0)
+            return;
+        end_field(len);
+        line_histogram_add(&stats->fields, column);
+        column = 0;
+    }
+
+    ALWAYS_INLINE void on_masks(uint64_t newline, uint64_t sep, uint64_t cr, uint64_t quoted) {
+        quoted ^= in_quote;
+        in_quote = (uint64_t)((int64_t)quoted >> 63);
+        uint64_t ends_with_cr = newline & ((cr << 1) | prev_cr);
+        prev_cr = cr >> 63;
+        newline &= ~quoted;
+        uint64_t mask = (newline | sep) & ~quoted;
+        if (__builtin_expect(mask == 0, 0)) {
+            field_len += 64;
+            return;
+        }
+        int last_pos = -1;
+        while (mask != 0) {
+            int pos = __builtin_ctzll(mask);
+            uint64_t len = field_len + (pos - last_pos - 1);
+            if ((newline >> pos) & 1)
+                end_row(len - ((ends_with_cr >> pos) & 1));
+            else
+                end_field(len);
+            field_len = 0;
+            last_pos = pos;
+            mask &= (mask - 1);
+        }
+        field_len = 63 - last_pos;
+    }
+
+    ALWAYS_INLINE bool done() const { return false; }
+
+    ALWAYS_INLINE void on_tail(const char* buffer, ssize_t size) {
+        for (ssize_t i = 0; i < size; i++) {
+            char c = buffer[i];
+            if (c == '"')
+                in_quote = ~in_quote;
+            if (!in_quote && c == '\n') {
+                end_row(field_len - prev_cr);
+                field_len = 0;
+            } else if (!in_quote && c == stats->separator) {
+                end_field(field_len);
+                field_len = 0;
+            } else {
+                ++field_len;
+            }
+            prev_cr = c == '\r';
+        }
+    }
+};
+
+// SSE2：每次16字节，四次比较拼成64位掩码
+template <typename Counter> static void scan_sse2(const char* buffer, ssize_t size, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + i)), newline));
+        uint64_t m1 =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + i + 16)), newline));
+        uint64_t m2 =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + i + 32)), newline));
+        uint64_t m3 =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buffer + i + 48)), newline));
+        counter.on_mask(m0 | (m1 << 16) | (m2 << 32) | (m3 << 48));
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+// AVX2：每次32字节
+template <typename Counter>
+__attribute__((target("avx2"))) static void scan_avx2(const char* buffer, ssize_t size, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t lo = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buffer + i)), newline));
+        uint64_t hi = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buffer + i + 32)), newline));
+        counter.on_mask(lo | (hi << 32));
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+// AVX-512BW：每次64字节，比较结果直接是64位掩码
+template <typename Counter>
+__attribute__((target("avx512f,avx512bw"))) static void scan_avx512(const char* buffer, ssize_t size, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m512i newline = _mm512_set1_epi8('\n');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(buffer + i)), newline);
+        counter.on_mask(mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+// 以下是多分隔符版本：分隔符只有一个字节时仍然用一次比较，多个字节时用半字节查表分类
+// 每个分隔符占 lo_lut/hi_lut 中的一位，字节 b 是分隔符当且仅当 lo_lut[b & 0xf] & hi_lut[b >> 4] 非零
+
+// SSE2 没有 pshufb，逐个分隔符比较后合并
+template <typename Counter>
+static void scan_delim_sse2(const char* buffer, ssize_t size, const DelimiterSet* set, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t mask = 0, cr_mask = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(buffer + i + k * 16));
+            __m128i hit = _mm_cmpeq_epi8(data, _mm_set1_epi8(set->bytes[0]));
+            for (int d = 1; d < set->count; d++)
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(data, _mm_set1_epi8(set->bytes[d])));
+            mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(hit) << (k * 16);
+            if (set->crlf)
+                cr_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, cr)) << (k * 16);
+        }
+        counter.on_masks(mask, cr_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx2"))) static void scan_delim_avx2(const char* buffer, ssize_t size, const DelimiterSet* set,
+                                                           Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m256i lo_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->lo_lut));
+    const __m256i hi_lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)set->hi_lut));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i single = _mm256_set1_epi8(set->bytes[0]);
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i zero = _mm256_setzero_si256();
+    const bool use_lut = set->count > 1;
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        __m256i d0 = _mm256_loadu_si256((const __m256i*)(buffer + i));
+        __m256i d1 = _mm256_loadu_si256((const __m256i*)(buffer + i + 32));
+        uint64_t mask, cr_mask = 0;
+        if (use_lut) {
+            __m256i c0 = _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, _mm256_and_si256(d0, nibble)),
+                                          _mm256_shuffle_epi8(hi_lut, _mm256_and_si256(_mm256_srli_epi16(d0, 4), nibble)));
+            __m256i c1 = _mm256_and_si256(_mm256_shuffle_epi8(lo_lut, _mm256_and_si256(d1, nibble)),
+                                          _mm256_shuffle_epi8(hi_lut, _mm256_and_si256(_mm256_srli_epi16(d1, 4), nibble)));
+            // 分类结果为0的字节不是分隔符
+            uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, zero));
+            uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, zero));
+            mask = ~(lo | (hi << 32));
+        } else {
+            uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, single));
+            uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, single));
+            mask = lo | (hi << 32);
+        }
+        if (set->crlf) {
+            uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, cr));
+            uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, cr));
+            cr_mask = lo | (hi << 32);
+        }
+        counter.on_masks(mask, cr_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx512f,avx512bw"))) static void scan_delim_avx512(const char* buffer, ssize_t size,
+                                                                         const DelimiterSet* set, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m512i lo_lut = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->lo_lut));
+    const __m512i hi_lut = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)set->hi_lut));
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    const __m512i single = _mm512_set1_epi8(set->bytes[0]);
+    const __m512i cr = _mm512_set1_epi8('\r');
+    const bool use_lut = set->count > 1;
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        __m512i data = _mm512_loadu_si512((const void*)(buffer + i));
+        uint64_t mask;
+        if (use_lut) {
+            __m512i lo = _mm512_shuffle_epi8(lo_lut, _mm512_and_si512(data, nibble));
+            __m512i hi = _mm512_shuffle_epi8(hi_lut, _mm512_and_si512(_mm512_srli_epi16(data, 4), nibble));
+            mask = _mm512_test_epi8_mask(lo, hi);
+        } else {
+            mask = _mm512_cmpeq_epi8_mask(data, single);
+        }
+        uint64_t cr_mask = set->crlf ? _mm512_cmpeq_epi8_mask(data, cr) : 0;
+        counter.on_masks(mask, cr_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+// 以下是 wc 融合版本：每64字节生成换行符、空白（' ' 和 '\t'..'\r'）、UTF-8 后续字节三个位图
+// 空白判断：b == ' ' 或 (uint8_t)(b - '\t') <= 4；后续字节判断：(b & 0xc0) == 0x80
+
+template <typename Counter> static void scan_wc_sse2(const char* buffer, ssize_t size, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i top2 = _mm_set1_epi8((char)0xc0);
+    const __m128i cont_bits = _mm_set1_epi8((char)0x80);
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t nl_mask = 0, space_mask = 0, cont_mask = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(buffer + i + k * 16));
+            __m128i ctrl = _mm_sub_epi8(data, tab);
+            // 无符号 ctrl <= 4 等价于 min(ctrl, 4) == ctrl
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(data, blank), _mm_cmpeq_epi8(_mm_min_epu8(ctrl, four), ctrl));
+            nl_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, newline)) << (k * 16);
+            space_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(space) << (k * 16);
+            cont_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(data, top2), cont_bits))
+                         << (k * 16);
+        }
+        counter.on_masks(nl_mask, space_mask, cont_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx2"))) static void scan_wc_avx2(const char* buffer, ssize_t size, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i blank = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i top2 = _mm256_set1_epi8((char)0xc0);
+    const __m256i cont_bits = _mm256_set1_epi8((char)0x80);
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t nl_mask = 0, space_mask = 0, cont_mask = 0;
+        for (int k = 0; k < 2; k++) {
+            __m256i data = _mm256_loadu_si256((const __m256i*)(buffer + i + k * 32));
+            __m256i ctrl = _mm256_sub_epi8(data, tab);
+            __m256i space =
+                _mm256_or_si256(_mm256_cmpeq_epi8(data, blank), _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, four), ctrl));
+            nl_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, newline)) << (k * 32);
+            space_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << (k * 32);
+            cont_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                             _mm256_cmpeq_epi8(_mm256_and_si256(data, top2), cont_bits))
+                         << (k * 32);
+        }
+        counter.on_masks(nl_mask, space_mask, cont_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx512f,avx512bw"))) static void scan_wc_avx512(const char* buffer, ssize_t size,
+                                                                      Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m512i newline = _mm512_set1_epi8('\n');
+    const __m512i blank = _mm512_set1_epi8(' ');
+    const __m512i tab = _mm512_set1_epi8('\t');
+    const __m512i four = _mm512_set1_epi8(4);
+    const __m512i top2 = _mm512_set1_epi8((char)0xc0);
+    const __m512i cont_bits = _mm512_set1_epi8((char)0x80);
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        __m512i data = _mm512_loadu_si512((const void*)(buffer + i));
+        uint64_t nl_mask = _mm512_cmpeq_epi8_mask(data, newline);
+        uint64_t space_mask =
+            _mm512_cmpeq_epi8_mask(data, blank) | _mm512_cmple_epu8_mask(_mm512_sub_epi8(data, tab), four);
+        uint64_t cont_mask = _mm512_cmpeq_epi8_mask(_mm512_and_si512(data, top2), cont_bits);
+        counter.on_masks(nl_mask, space_mask, cont_mask);
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+// 以下是 CSV 版本：每64字节生成换行符、分隔符、'\r'、双引号四个位图，再求引号位图的前缀异或
+
+// 移位版本的前缀异或（SSE2 基线没有 PCLMULQDQ）
+static ALWAYS_INLINE uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// 与全1做无进位乘法：结果第 i 位是 bits 第 0..i 位的异或，一条指令代替六次移位异或
+__attribute__((target("pclmul"))) static ALWAYS_INLINE uint64_t prefix_xor_clmul(uint64_t bits) {
+    return (uint64_t)_mm_cvtsi128_si64(
+        _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)bits), _mm_set1_epi8((char)0xff), 0));
+}
+
+template <typename Counter>
+static void scan_csv_sse2(const char* buffer, ssize_t size, const CsvStats* stats, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i sep = _mm_set1_epi8(stats->separator);
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i quote = _mm_set1_epi8('"');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        uint64_t nl_mask = 0, sep_mask = 0, cr_mask = 0, quote_mask = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(buffer + i + k * 16));
+            nl_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, newline)) << (k * 16);
+            sep_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, sep)) << (k * 16);
+            cr_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, cr)) << (k * 16);
+            quote_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(data, quote)) << (k * 16);
+        }
+        counter.on_masks(nl_mask, sep_mask, cr_mask, prefix_xor(quote_mask));
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx2,pclmul"))) static void scan_csv_avx2(const char* buffer, ssize_t size,
+                                                                const CsvStats* stats, Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i sep = _mm256_set1_epi8(stats->separator);
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i quote = _mm256_set1_epi8('"');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        __m256i d0 = _mm256_loadu_si256((const __m256i*)(buffer + i));
+        __m256i d1 = _mm256_loadu_si256((const __m256i*)(buffer + i + 32));
+        uint64_t nl_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, newline)) |
+                           (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, newline)) << 32;
+        uint64_t sep_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, sep)) |
+                            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, sep)) << 32;
+        uint64_t cr_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, cr)) |
+                           (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, cr)) << 32;
+        uint64_t quote_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d0, quote)) |
+                              (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(d1, quote)) << 32;
+        counter.on_masks(nl_mask, sep_mask, cr_mask, prefix_xor_clmul(quote_mask));
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+template <typename Counter>
+__attribute__((target("avx512f,avx512bw,pclmul"))) static void scan_csv_avx512(const char* buffer, ssize_t size,
+                                                                              const CsvStats* stats,
+                                                                              Counter& state) {
+    Counter counter = state; // 局部副本，保证状态留在寄存器里
+    ssize_t i = 0;
+    const __m512i newline = _mm512_set1_epi8('\n');
+    const __m512i sep = _mm512_set1_epi8(stats->separator);
+    const __m512i cr = _mm512_set1_epi8('\r');
+    const __m512i quote = _mm512_set1_epi8('"');
+    for (; i + 64 <= size && !counter.done(); i += 64) {
+        __m512i data = _mm512_loadu_si512((const void*)(buffer + i));
+        counter.on_masks(_mm512_cmpeq_epi8_mask(data, newline), _mm512_cmpeq_epi8_mask(data, sep),
+                         _mm512_cmpeq_epi8_mask(data, cr), prefix_xor_clmul(_mm512_cmpeq_epi8_mask(data, quote)));
+    }
+    if (!counter.done())
+        counter.on_tail(buffer + i, size - i);
+    state = counter;
+}
+
+struct KernelChoice {
+    void (*legacy)(const char*, ssize_t, LegacyCounter&);
+    void (*wide)(const char*, ssize_t, WideCounter&);
+    void (*indexed)(const char*, ssize_t, IndexedCounter&);
+    void (*nth_newline)(const char*, ssize_t, NthNewlineCounter&);
+    void (*delim)(const char*, ssize_t, const DelimiterSet*, DelimCounter&);
+    void (*wc)(const char*, ssize_t, WcCounter&);
+    void (*csv)(const char*, ssize_t, const CsvStats*, CsvCounter&);
+    const char* name;
+};
+
+static KernelChoice select_kernel() {
+    __builtin_cpu_init();
+    bool has_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    bool has_pclmul = __builtin_cpu_supports("pclmul");
+
+    const KernelChoice sse2 = {scan_sse2<LegacyCounter>, scan_sse2<WideCounter>, scan_sse2<IndexedCounter>,
+                               scan_sse2<NthNewlineCounter>, scan_delim_sse2<DelimCounter>,
+                               scan_wc_sse2<WcCounter>, scan_csv_sse2<CsvCounter>, "SSE2"};
+    const KernelChoice avx2 = {scan_avx2<LegacyCounter>, scan_avx2<WideCounter>, scan_avx2<IndexedCounter>,
+                               scan_avx2<NthNewlineCounter>, scan_delim_avx2<DelimCounter>,
+                               scan_wc_avx2<WcCounter>, scan_csv_avx2<CsvCounter>, "AVX2"};
+    const KernelChoice avx512 = {scan_avx512<LegacyCounter>, scan_avx512<WideCounter>, scan_avx512<IndexedCounter>,
+                               scan_avx512<NthNewlineCounter>, scan_delim_avx512<DelimCounter>,
+                               scan_wc_avx512<WcCounter>, scan_csv_avx512<CsvCounter>, "AVX-512BW"};
+
+    KernelChoice choice = has_avx512 ? avx512 : (has_avx2 ? avx2 : sse2);
+
+    // 环境变量只能选择CPU实际支持的版本，不支持或无法识别时提示并保留自动检测的结果
+    const char* forced = getenv("FILELINES_SIMD");
+    if (forced != NULL) {
+        if (strcmp(forced, "sse2") == 0)
+            choice = sse2;
+        else if (strcmp(forced, "avx2") == 0 && has_avx2)
+            choice = avx2;
+        else if (strcmp(forced, "avx512") == 0 && has_avx512)
+            choice = avx512;
+        else if (strcmp(forced, "avx2") == 0 || strcmp(forced, "avx512") == 0)
+            fprintf(stderr, "FILELINES_SIMD=%s: not supported by this CPU, using %s\n", forced, choice.name);
+        else
+            fprintf(stderr, "FILELINES_SIMD=%s: unknown kernel (expected sse2, avx2 or avx512), using %s\n", forced,
+                    choice.name);
+    }
+
+    // 没有 PCLMULQDQ 的CPU上 CSV 内核退回到移位求前缀异或的版本
+    if (!has_pclmul)
+        choice.csv = scan_csv_sse2<CsvCounter>;
+    return choice;
+}
+
+static const KernelChoice selected_kernel = select_kernel();
+
+void process_block_simd_opt(const char* buffer, ssize_t size, uint32_t* total_line_num, uint32_t* line_num,
+                            int* cur_len) {
+    LegacyCounter counter = {line_num, *total_line_num, *cur_len};
+    selected_kernel.legacy(buffer, size, counter);
+    *total_line_num = counter.total_line_num;
+    *cur_len = counter.cur_len;
+}
+
+void process_block_simd_wide(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len) {
+    WideCounter counter = {hist, hist->total_line_num, *cur_len};
+    selected_kernel.wide(buffer, size, counter);
+    hist->total_line_num = counter.total_line_num;
+    *cur_len = counter.cur_len;
+}
+
+void process_block_simd_indexed(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len,
+                                LineOffsetSink* sink) {
+    IndexedCounter counter = {{hist, 0, *cur_len}, sink, sink->stride, sink->offset, sink->next_line - sink->lines};
+    selected_kernel.indexed(buffer, size, counter);
+    hist->total_line_num += counter.wide.total_line_num;
+    *cur_len = counter.wide.cur_len;
+    sink->next_line = sink->lines + counter.next_line;
+    sink->lines += counter.wide.total_line_num;
+    sink->offset += size;
+}
+
+ssize_t find_nth_newline(const char* buffer, ssize_t size, uint64_t* n) {
+    if (*n == 0)
+        return -1;
+    NthNewlineCounter counter = {*n, 0, -1};
+    selected_kernel.nth_newline(buffer, size, counter);
+    *n = counter.remaining;
+    return counter.found;
+}
+
+void delimiter_set_init(DelimiterSet* set, const char* delimiters, int count, bool crlf) {
+    memset(set, 0, sizeof(DelimiterSet));
+    if (count > MAX_DELIMITERS)
+        count = MAX_DELIMITERS;
+    for (int i = 0; i < count; i++) {
+        unsigned char c = (unsigned char)delimiters[i];
+        if (set->table[c])
+            continue;
+        set->table[c] = 1;
+        set->lo_lut[c & 0x0f] |= (uint8_t)(1 << set->count);
+        set->hi_lut[c >> 4] |= (uint8_t)(1 << set->count);
+        set->bytes[set->count++] = c;
+    }
+    // 空集合按默认的换行符处理
+    if (set->count == 0) {
+        set->table[(unsigned char)'\n'] = 1;
+        set->lo_lut['\n' & 0x0f] = 1;
+        set->hi_lut['\n' >> 4] = 1;
+        set->bytes[0] = '\n';
+        set->count = 1;
+    }
+    // '\r' 本身是分隔符时它已经结束了一行，不能再从下一行里扣掉
+    set->crlf = crlf && !set->table[(unsigned char)'\r'];
+}
+
+void process_block_simd_delim(const char* buffer, ssize_t size, const DelimiterSet* set, LineHistogram* hist,
+                              uint64_t* cur_len, bool* prev_cr) {
+    DelimCounter counter = {{hist, hist->total_line_num, *cur_len}, set, *prev_cr ? 1u : 0u};
+    selected_kernel.delim(buffer, size, set, counter);
+    hist->total_line_num = counter.wide.total_line_num;
+    *cur_len = counter.wide.cur_len;
+    *prev_cr = counter.prev_cr != 0;
+}
+
+void wc_counts_init(WcCounts* counts, bool codepoint_len) {
+    memset(counts, 0, sizeof(WcCounts));
+    counts->prev_space = true;
+    counts->codepoint_len = codepoint_len;
+}
+
+void process_block_simd_wc(const char* buffer, ssize_t size, LineHistogram* hist, uint64_t* cur_len,
+                           WcCounts* counts) {
+    WcCounter counter = {{hist, hist->total_line_num, *cur_len}, counts->words, counts->chars,
+                         counts->prev_space ? 1u : 0u, counts->codepoint_len};
+    selected_kernel.wc(buffer, size, counter);
+    hist->total_line_num = counter.wide.total_line_num;
+    *cur_len = counter.wide.cur_len;
+    counts->words = counter.words;
+    counts->chars = counter.chars;
+    counts->bytes += size;
+    counts->prev_space = counter.prev_space != 0;
+}
+
+void csv_stats_init(CsvStats* stats, char separator) {
+    memset(stats, 0, sizeof(CsvStats));
+    stats->separator = separator;
+}
+
+void process_block_simd_csv(const char* buffer, ssize_t size, CsvStats* stats) {
+    CsvCounter counter = {stats, stats->field_len, stats->column, stats->in_quote ? ~0ULL : 0,
+                          stats->prev_cr ? 1u : 0u};
+    selected_kernel.csv(buffer, size, stats, counter);
+    stats->field_len = counter.field_len;
+    stats->column = counter.column;
+    stats->in_quote = counter.in_quote != 0;
+    stats->prev_cr = counter.prev_cr != 0;
+}
+
+void csv_stats_finish(CsvStats* stats) {
+    CsvCounter counter = {stats, stats->field_len, stats->column, 0, 0};
+    counter.end_row(stats->field_len);
+    stats->field_len = 0;
+    stats->column = 0;
+    stats->in_quote = false;
+    stats->prev_cr = false;
+}
+
+const char* simd_kernel_name() { return selected_kernel.name; }
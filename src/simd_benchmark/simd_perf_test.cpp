@@ -2,78 +2,50 @@
  * SIMD优化性能测试程序
  * 对比：标量版本（basic_benchmark） vs SIMD优化版本
  * 块大小：256KB（与basic_benchmark一致）
+ * 每个版本由 bench_harness 预热并自适应重复运行，报告中位数、最快、标准差和 95% 置信区间
  */
 
+#include "bench_filelines.h"
 #include "filelines_baseline.h"
 #include "filelines_simd_opt.h"
-#include "find_most_freq.h"
+#include "perf_counters.h"
+#include "simd_kernel.h"
 
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <string>
+#include <vector>
 
 using namespace std;
 
-struct TestResult {
-    double time_seconds;
-    double throughput_mb_s;
-    uint32_t total_lines;
-    uint32_t most_freq_len;
-    uint32_t most_freq_count;
-};
-
-TestResult run_test(char* filepath, void (*test_func)(char*, uint32_t*, uint32_t*), const char* version_name) {
-    uint32_t line_num[MAX_LEN];
-    uint32_t total_line_num = 0;
-
-    // 初始化
-    memset(line_num, 0, sizeof(line_num));
-
-    cout << "  运行 " << version_name << "..." << flush;
-
-    // 计时
-    auto start = chrono::high_resolution_clock::now();
-    test_func(filepath, &total_line_num, line_num);
-    auto end = chrono::high_resolution_clock::now();
-
-    chrono::duration<double> duration = end - start;
-
-    // 查找最频繁的行长度
-    uint32_t most_freq_len, most_freq_len_linenum;
-    find_most_freq_line(line_num, &most_freq_len, &most_freq_len_linenum);
-
-    // 获取文件大小
-    FILE* fp = fopen(filepath, "rb");
-    long file_size = 0;
-    if (fp) {
-        fseek(fp, 0, SEEK_END);
-        file_size = ftell(fp);
-        fclose(fp);
-    }
-
-    TestResult result;
-    result.time_seconds = duration.count();
-    result.throughput_mb_s = (file_size / (1024.0 * 1024.0)) / duration.count();
-    result.total_lines = total_line_num;
-    result.most_freq_len = most_freq_len;
-    result.most_freq_count = most_freq_len_linenum;
-
-    cout << " 完成 (" << fixed << setprecision(3) << duration.count() << "s)" << endl;
-
-    return result;
-}
-
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "用法: %s <filepath>\n", argv[0]);
+    // --mmap: SIMD版本改用 mmap 零拷贝读取；其余选项见 bench_usage
+    bool use_mmap = false, bad_option = false;
+    BenchConfig config;
+    bench_config_init(&config);
+    for (int i = 1; i < argc - 1; i++) {
+        int used = bench_parse_option(&config, argc - 1, argv, i);
+        if (used > 0)
+            i += used - 1;
+        else if (used == 0 && strcmp(argv[i], "--mmap") == 0)
+            use_mmap = true;
+        else
+            bad_option = true;
+    }
+    if (argc < 2 || bad_option) {
+        fprintf(stderr, "用法: %s [--mmap] [选项] <filepath>\n", argv[0]);
         fprintf(stderr, "示例: %s test_2gb.txt\n", argv[0]);
+        fprintf(stderr, "选项:\n%s", bench_usage());
         return 1;
     }
 
-    char* filepath = argv[1];
+    char* filepath = argv[argc - 1];
+    void (*simd_func)(char*, uint32_t*, uint32_t*) = use_mmap ? filelines_simd_mmap : filelines_simd;
+    string simd_label = string("SIMD版本 (") + simd_kernel_name() + (use_mmap ? ", mmap)" : ")");
+    const char* simd_name = simd_label.c_str();
 
     // 检查文件
     FILE* fp = fopen(filepath, "rb");
@@ -92,57 +64,41 @@ int main(int argc, char* argv[]) {
 
     cout << "测试文件: " << filepath << endl;
     cout << "文件大小: " << fixed << setprecision(2) << (file_size / (1024.0 * 1024.0 * 1024.0)) << " GB" << endl;
-    cout << "块大小: 256 KB\n" << endl;
-
-    cout << "运行测试（每个版本测试3次取平均）...\n" << endl;
-
-    // 测试3次取平均
-    TestResult baseline_results[3], simd_results[3];
-
-    for (int i = 0; i < 3; i++) {
-        cout << "[测试轮次 " << (i + 1) << "/3]" << endl;
-        baseline_results[i] = run_test(filepath, filelines_baseline, "标量版本");
-        simd_results[i] = run_test(filepath, filelines_simd, "SIMD版本");
-        cout << endl;
-    }
-
-    // 计算平均值
-    TestResult baseline_avg = {0}, simd_avg = {0};
-
-    for (int i = 0; i < 3; i++) {
-        baseline_avg.time_seconds += baseline_results[i].time_seconds / 3.0;
-        baseline_avg.throughput_mb_s += baseline_results[i].throughput_mb_s / 3.0;
-        simd_avg.time_seconds += simd_results[i].time_seconds / 3.0;
-        simd_avg.throughput_mb_s += simd_results[i].throughput_mb_s / 3.0;
-    }
-
-    baseline_avg.total_lines = baseline_results[0].total_lines;
-    baseline_avg.most_freq_len = baseline_results[0].most_freq_len;
-    baseline_avg.most_freq_count = baseline_results[0].most_freq_count;
-    simd_avg.total_lines = simd_results[0].total_lines;
-    simd_avg.most_freq_len = simd_results[0].most_freq_len;
-    simd_avg.most_freq_count = simd_results[0].most_freq_count;
-
-    cout << "========================================" << endl;
-    cout << "          平均测试结果" << endl;
-    cout << "========================================\n" << endl;
-
-    cout << left << setw(20) << "版本" << setw(15) << "时间(秒)" << setw(18) << "吞吐量(MB/s)" << setw(12) << "总行数"
+    cout << "块大小: 256 KB" << endl;
+    cout << "SIMD内核: " << simd_kernel_name() << endl;
+    cout << "SIMD读取方式: " << (use_mmap ? "mmap" : "read") << endl;
+
+    PerfCounters probe;
+    int num_counters = perf_counters_open(&probe);
+    perf_counters_close(&probe);
+    if (num_counters == 0)
+        cout << "硬件计数器: 不可用（perf_event_paranoid 限制或没有 PMU），计数器列显示 n/a" << endl;
+    else
+        cout << "硬件计数器: " << num_counters << "/" << PERF_NUM_EVENTS << " 个事件可用" << endl;
+    cout << endl;
+
+    cout << "运行测试（每个版本预热 " << config.warmups << " 次，再运行 " << config.min_runs << "~" << config.max_runs
+         << " 次直到置信区间足够窄）...\n"
          << endl;
-    cout << string(65, '-') << endl;
 
-    cout << left << setw(20) << "标量版本" << fixed << setprecision(4) << setw(15) << baseline_avg.time_seconds
-         << setprecision(2) << setw(18) << baseline_avg.throughput_mb_s << setw(12) << baseline_avg.total_lines << endl;
+    FilelinesBenchCase baseline_case, simd_case;
+    filelines_bench_case_init(&baseline_case, "标量版本", filepath, filelines_baseline, FILELINES_CACHE_ANY);
+    filelines_bench_case_init(&simd_case, simd_name, filepath, simd_func, FILELINES_CACHE_ANY);
+    vector<BenchCase*> cases = {&baseline_case.base, &simd_case.base};
+    vector<BenchResult> results;
+    bench_run_all(cases, &config, &results);
+    const BenchResult& baseline = results[0];
+    const BenchResult& simd = results[1];
 
-    cout << left << setw(20) << "SIMD版本 (AVX2)" << fixed << setprecision(4) << setw(15) << simd_avg.time_seconds
-         << setprecision(2) << setw(18) << simd_avg.throughput_mb_s << setw(12) << simd_avg.total_lines << endl;
+    cout << "\n========================================" << endl;
+    cout << "          测试结果" << endl;
+    cout << "========================================\n" << endl;
 
-    cout << string(65, '-') << endl;
+    bench_print_results(results);
 
-    // 计算性能提升
-    double speedup = baseline_avg.time_seconds / simd_avg.time_seconds;
-    double throughput_improvement =
-        (simd_avg.throughput_mb_s - baseline_avg.throughput_mb_s) / baseline_avg.throughput_mb_s * 100.0;
+    // 计算性能提升（按中位数）
+    double speedup = baseline.median / simd.median;
+    double throughput_improvement = (simd.throughput - baseline.throughput) / baseline.throughput * 100.0;
 
     cout << "\n性能分析:" << endl;
     cout << "  加速比: " << fixed << setprecision(2) << speedup << "x";
@@ -152,19 +108,25 @@ int main(int argc, char* argv[]) {
         cout << " (标量更快 " << setprecision(1) << (1.0 / speedup - 1.0) * 100 << "%)" << endl;
     }
     cout << "  吞吐量提升: " << setprecision(1) << throughput_improvement << "%" << endl;
-    cout << "  时间节省: " << setprecision(3) << (baseline_avg.time_seconds - simd_avg.time_seconds) << " 秒" << endl;
+    cout << "  时间节省: " << setprecision(3) << (baseline.median - simd.median) << " 秒" << endl;
+    // 两个版本的置信区间不重叠时差异可信
+    bool significant = simd.ci_high < baseline.ci_low || baseline.ci_high < simd.ci_low;
+    cout << "  差异显著性: " << (significant ? "95% 置信区间不重叠" : "95% 置信区间重叠，差异不显著") << endl;
 
     // 验证结果一致性
-    bool results_match = (baseline_avg.total_lines == simd_avg.total_lines) &&
-                         (baseline_avg.most_freq_len == simd_avg.most_freq_len) &&
-                         (baseline_avg.most_freq_count == simd_avg.most_freq_count);
+    bool results_match = baseline.stable && simd.stable && (baseline_case.total_lines == simd_case.total_lines) &&
+                         (baseline_case.most_freq_len == simd_case.most_freq_len) &&
+                         (baseline_case.most_freq_count == simd_case.most_freq_count);
 
     cout << "\n结果验证:" << endl;
-    cout << "  总行数: " << baseline_avg.total_lines << (results_match ? " ✓" : " ✗") << endl;
-    cout << "  最频繁长度: " << baseline_avg.most_freq_len << " (出现 " << baseline_avg.most_freq_count << " 次)"
+    cout << "  总行数: " << baseline_case.total_lines << (results_match ? " ✓" : " ✗") << endl;
+    cout << "  最频繁长度: " << baseline_case.most_freq_len << " (出现 " << baseline_case.most_freq_count << " 次)"
          << (results_match ? " ✓" : " ✗") << endl;
     cout << "  数据一致性: " << (results_match ? "通过 ✓" : "失败 ✗") << endl;
 
+    if (!bench_emit(&config, "simd_perf_test", results))
+        results_match = false;
+
     cout << "\n========================================\n" << endl;
 
     return results_match ? 0 : 1;
@@ -0,0 +1,165 @@
+#include "uring_reader.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int uring_reader_init(UringReader* reader, unsigned entries) {
+    memset(reader, 0, sizeof(UringReader));
+    reader->ring_fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(entries, &params);
+    if (fd < 0)
+        return -errno;
+    reader->ring_fd = fd;
+    reader->sq_entries = params.sq_entries;
+
+    reader->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    reader->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    // 新内核上 SQ/CQ 环共用一次映射
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        if (reader->cq_ring_size > reader->sq_ring_size)
+            reader->sq_ring_size = reader->cq_ring_size;
+        reader->cq_ring_size = reader->sq_ring_size;
+    }
+
+    reader->sq_ring_ptr =
+        mmap(NULL, reader->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (reader->sq_ring_ptr == MAP_FAILED) {
+        reader->sq_ring_ptr = NULL;
+        uring_reader_destroy(reader);
+        return -ENOMEM;
+    }
+
+    if (single_mmap) {
+        reader->cq_ring_ptr = reader->sq_ring_ptr;
+    } else {
+        reader->cq_ring_ptr = mmap(
+            NULL, reader->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (reader->cq_ring_ptr == MAP_FAILED) {
+            reader->cq_ring_ptr = NULL;
+            uring_reader_destroy(reader);
+            return -ENOMEM;
+        }
+    }
+
+    reader->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    reader->sqes = (struct io_uring_sqe*)mmap(
+        NULL, reader->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (reader->sqes == MAP_FAILED) {
+        reader->sqes = NULL;
+        uring_reader_destroy(reader);
+        return -ENOMEM;
+    }
+
+    char* sq = (char*)reader->sq_ring_ptr;
+    reader->sq_head = (unsigned*)(sq + params.sq_off.head);
+    reader->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    reader->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    reader->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+    char* cq = (char*)reader->cq_ring_ptr;
+    reader->cq_head = (unsigned*)(cq + params.cq_off.head);
+    reader->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    reader->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    reader->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    return 0;
+}
+
+int uring_reader_register_buffers(UringReader* reader, const struct iovec* iovecs, unsigned nr) {
+    if (sys_io_uring_register(reader->ring_fd, IORING_REGISTER_BUFFERS, iovecs, nr) < 0)
+        return -errno;
+    reader->fixed_buffers = true;
+    return 0;
+}
+
+bool uring_reader_prep_read(UringReader* reader, int fd, void* buf, unsigned len, off_t offset, int buf_index,
+                            uint64_t user_data) {
+    unsigned tail = *reader->sq_tail;
+    unsigned head = __atomic_load_n(reader->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= reader->sq_entries)
+        return false;
+
+    unsigned index = tail & *reader->sq_mask;
+    struct io_uring_sqe* sqe = &reader->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    if (reader->fixed_buffers && buf_index >= 0) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)buf_index;
+    } else {
+        sqe->opcode = IORING_OP_READ;
+    }
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = (uint64_t)offset;
+    sqe->user_data = user_data;
+
+    reader->sq_array[index] = index;
+    // 内核看到新的 tail 之前，SQE 的内容必须已经写好
+    __atomic_store_n(reader->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    reader->sq_pending++;
+    return true;
+}
+
+int uring_reader_submit(UringReader* reader, unsigned wait_nr) {
+    unsigned to_submit = reader->sq_pending;
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    if (to_submit == 0 && wait_nr == 0)
+        return 0;
+
+    while (1) {
+        int ret = sys_io_uring_enter(reader->ring_fd, to_submit, wait_nr, flags);
+        if (ret >= 0) {
+            reader->sq_pending -= (unsigned)ret < to_submit ? (unsigned)ret : to_submit;
+            return 0;
+        }
+        if (errno != EINTR)
+            return -errno;
+    }
+}
+
+bool uring_reader_pop(UringReader* reader, uint64_t* user_data, int* res) {
+    unsigned head = *reader->cq_head;
+    unsigned tail = __atomic_load_n(reader->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return false;
+
+    struct io_uring_cqe* cqe = &reader->cqes[head & *reader->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(reader->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void uring_reader_destroy(UringReader* reader) {
+    if (reader->sqes)
+        munmap(reader->sqes, reader->sqes_size);
+    if (reader->cq_ring_ptr && reader->cq_ring_ptr != reader->sq_ring_ptr)
+        munmap(reader->cq_ring_ptr, reader->cq_ring_size);
+    if (reader->sq_ring_ptr)
+        munmap(reader->sq_ring_ptr, reader->sq_ring_size);
+    if (reader->ring_fd >= 0)
+        close(reader->ring_fd);
+    memset(reader, 0, sizeof(UringReader));
+    reader->ring_fd = -1;
+}
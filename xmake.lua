@@ -8,41 +8,77 @@ add_includedirs("./include")
 -- 使用本机架构优化
 add_cxflags("-march=native")
 
+-- 结果库（bench_store）中记录的构建版本：编译时的 git describe，环境变量 BENCH_REVISION 可在运行时覆盖
+rule("bench_revision")
+    on_load(function (target)
+        local revision = try { function () return os.iorun("git describe --always --dirty") end }
+        revision = revision and revision:trim() or "unknown"
+        target:add("defines", "BENCH_GIT_REVISION=\"" .. revision .. "\"")
+    end)
+rule_end()
+
 -- 矩阵乘法程序
 target("matrix_multiply")
     set_kind("binary")
-    add_files("src/matrix_multiply/matrix_multiply.cpp")
+    add_files("src/matrix_multiply/matrix_multiply.cpp", "src/huge_pages.cpp", "src/numa_topology.cpp", "src/perf_counters.cpp", "src/bench_harness.cpp", "src/bench_store.cpp")
+    add_rules("bench_revision")
     add_cxflags("-msse", "-mavx", "-mfma")
     add_syslinks("pthread")
 
 -- 文件行分析程序
 target("filelines")
     set_kind("binary")
-    add_files("src/basic_benchmark/filelines.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/find_most_freq.cpp","src/simd_benchmark/filelines_mt.cpp")
+    add_files("src/basic_benchmark/filelines.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/find_most_freq.cpp","src/simd_benchmark/filelines_mt.cpp", "src/simd_benchmark/filelines_autotune.cpp", "src/simd_benchmark/filelines_sample.cpp", "src/simd_benchmark/range_scan.cpp", "src/simd_benchmark/filelines_simd_opt.cpp", "src/simd_benchmark/filelines_stream.cpp", "src/simd_benchmark/filelines_checkpoint.cpp", "src/simd_benchmark/line_index.cpp", "src/simd_benchmark/simd_kernel.cpp", "src/line_histogram.cpp", "src/line_summary.cpp", "src/huge_pages.cpp", "src/numa_topology.cpp", "src/simd_benchmark/uring_reader.cpp", "src/direct_io.cpp", "src/page_cache.cpp")
 
 -- 测试文件生成器
 target("filelines_gen")
     set_kind("binary")
     add_files("src/filelines_gen.cpp")
 
+-- 基准结果对比工具（结果库中两个版本的吞吐量回退检查）
+target("bench_compare")
+    set_kind("binary")
+    add_files("src/bench_compare.cpp", "src/bench_store.cpp", "src/bench_harness.cpp", "src/perf_counters.cpp")
+    add_rules("bench_revision")
+
 -- 块大小性能测试程序
 target("blocksize_benchmark")
     set_kind("binary")
-    add_files("src/blocksize_benchmark/blocksize_benchmark.cpp", "src/blocksize_benchmark/filelines_blocksize.cpp", "src/find_most_freq.cpp")
+    add_files("src/blocksize_benchmark/blocksize_benchmark.cpp", "src/blocksize_benchmark/filelines_blocksize.cpp", "src/direct_io.cpp", "src/find_most_freq.cpp", "src/perf_counters.cpp")
 
 -- SIMD性能测试程序
 target("simd_perf_test")
     set_kind("binary")
-    add_files("src/simd_benchmark/simd_perf_test.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/simd_benchmark/filelines_simd_opt.cpp", "src/find_most_freq.cpp")
+    add_files("src/simd_benchmark/simd_perf_test.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/simd_benchmark/filelines_simd_opt.cpp", "src/simd_benchmark/simd_kernel.cpp", "src/line_histogram.cpp", "src/find_most_freq.cpp", "src/huge_pages.cpp", "src/page_cache.cpp", "src/perf_counters.cpp", "src/simd_benchmark/bench_filelines.cpp", "src/bench_harness.cpp", "src/bench_store.cpp")
+    add_rules("bench_revision")
     add_cxflags("-mavx2", "-mfma")
 
 -- 多线程SIMD性能测试程序（生产者-消费者模型）
 target("mt_perf_test")
     set_kind("binary")
-    add_files("src/simd_benchmark/mt_perf_test.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/simd_benchmark/filelines_simd_opt.cpp", "src/simd_benchmark/filelines_mt.cpp", "src/find_most_freq.cpp")
+    add_files("src/simd_benchmark/mt_perf_test.cpp", "src/basic_benchmark/filelines_baseline.cpp", "src/simd_benchmark/filelines_simd_opt.cpp", "src/simd_benchmark/filelines_mt.cpp", "src/simd_benchmark/range_scan.cpp", "src/simd_benchmark/simd_kernel.cpp", "src/line_histogram.cpp", "src/huge_pages.cpp", "src/numa_topology.cpp", "src/simd_benchmark/uring_reader.cpp", "src/direct_io.cpp", "src/find_most_freq.cpp", "src/page_cache.cpp", "src/perf_counters.cpp", "src/simd_benchmark/bench_filelines.cpp", "src/bench_harness.cpp", "src/bench_store.cpp")
+    add_rules("bench_revision")
     add_cxflags("-mavx2", "-mfma")
     add_syslinks("pthread")
 
+-- 批量文件行分析程序（共享线程池 + 工作窃取，或协程流水线）
+target("filelines_batch")
+    set_kind("binary")
+    add_files("src/batch_benchmark/filelines_pipeline.cpp", {languages = "c++20"})
+    add_files("src/batch_benchmark/batch_benchmark.cpp", "src/batch_benchmark/filelines_batch.cpp", "src/simd_benchmark/uring_reader.cpp", "src/simd_benchmark/range_scan.cpp", "src/simd_benchmark/simd_kernel.cpp", "src/line_histogram.cpp", "src/line_summary.cpp", "src/direct_io.cpp", "src/find_most_freq.cpp", "src/page_cache.cpp")
+    add_syslinks("pthread")
+
+-- 常驻分析守护进程（Unix 域套接字 + 结果缓存）
+target("filelines_daemon")
+    set_kind("binary")
+    add_files("src/daemon/filelines_daemon.cpp", "src/daemon/daemon_client.cpp", "src/simd_benchmark/range_scan.cpp", "src/simd_benchmark/simd_kernel.cpp", "src/line_histogram.cpp", "src/direct_io.cpp", "src/find_most_freq.cpp", "src/page_cache.cpp")
+    add_syslinks("pthread")
+
+-- 守护进程的命令行客户端
+target("filelines_client")
+    set_kind("binary")
+    add_files("src/daemon/filelines_client.cpp", "src/daemon/daemon_client.cpp", "src/line_histogram.cpp", "src/find_most_freq.cpp")
+
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
 --